@@ -0,0 +1,259 @@
+/**
+* @file affinity.c
+* @brief CPU placement of the commands and of nanoShell (--cpus, --placement, --shell-cpu)
+*
+* The masks are computed once at the start. Each child takes the next slot from a counter in shared memory, 
+* so the workers of --jobs go on spreading the commands, and sets its own affinity before exec.
+* The NUMA nodes are read from /sys/devices/system/node; without it all the CPUs are in one node.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "affinity.h"
+#include "nanoShell.h"
+
+#define NANO_NODE_CPULIST "/sys/devices/system/node/node%d/cpulist"
+#define NANO_MAX_NODES 64
+
+int nano_affinity_enabled = 0;
+
+static cpu_set_t *masks; // One mask per slot
+static int n_masks;
+static atomic_uint *next_slot;
+
+
+/*******************************************************************************************************************
+ * Function nano_affinity_parse_list
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function parses the CPU list @param list, in the format of taskset and sysfs ("0-3,8,10-11"), 
+ * 		into @param set.
+ * 
+ * @return Function returns 0 if OK and -1 if @param list isn't a valid list
+ *******************************************************************************************************************/
+static int nano_affinity_parse_list(const char *list, cpu_set_t *set)
+{
+	const char *str = list;
+
+	CPU_ZERO(set);
+	while (*str != 0 && *str != '\n')
+	{
+		char *end;
+		long first = strtol(str, &end, 10);
+		long last = first;
+
+		if (end == str || first < 0)
+		{
+			return -1;
+		}
+		if (*end == '-')
+		{
+			str = end + 1;
+			last = strtol(str, &end, 10);
+			if (end == str || last < first)
+			{
+				return -1;
+			}
+		}
+		if (last >= CPU_SETSIZE)
+		{
+			return -1;
+		}
+		for (long cpu = first; cpu <= last; cpu++)
+		{
+			CPU_SET((int)cpu, set);
+		}
+
+		str = end;
+		if (*str == ',')
+		{
+			str++;
+		}
+		else if (*str != 0 && *str != '\n')
+		{
+			return -1;
+		}
+	}
+	return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_affinity_parse_policy
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function parses the placement policy @param str: "rr", "pack" or "numa".
+ * 
+ * @return Function returns the NANO_PLACEMENT_ of @param str or -1 if it isn't valid
+ *******************************************************************************************************************/
+int nano_affinity_parse_policy(const char *str)
+{
+	if (strcmp(str, "rr") == 0)
+	{
+		return NANO_PLACEMENT_RR;
+	}
+	else if (strcmp(str, "pack") == 0)
+	{
+		return NANO_PLACEMENT_PACK;
+	}
+	else if (strcmp(str, "numa") == 0)
+	{
+		return NANO_PLACEMENT_NUMA;
+	}
+	return -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_affinity_add
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function appends @param set to the masks of the slots.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_affinity_add(const cpu_set_t *set)
+{
+	cpu_set_t *grown = REALLOC(masks, (size_t)(n_masks + 1) * sizeof(cpu_set_t));
+
+	if (grown == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating the CPU masks\n");
+	}
+	masks = grown;
+	masks[n_masks++] = *set;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_affinity_init
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function computes the masks of the commands for the CPUs @param list (NULL for the CPUs nanoShell is 
+ * 		allowed to use) and the placement @param policy. If @param shell_cpu isn't -1 nanoShell is pinned to
+ * 		that CPU, which is taken out of the CPUs of the commands.
+ * 
+ * @return Function returns 0 if OK and -1 if @param list isn't valid, has only @param shell_cpu or nanoShell 
+ * 		can't be pinned
+ *******************************************************************************************************************/
+int nano_affinity_init(const char *list, int policy, int shell_cpu)
+{
+	cpu_set_t cpus;
+
+	if (list != NULL ? nano_affinity_parse_list(list, &cpus) == -1 
+					 : sched_getaffinity(0, sizeof(cpus), &cpus) == -1)
+	{
+		return -1;
+	}
+
+	if (shell_cpu != -1)
+	{
+		cpu_set_t shell;
+
+		if (shell_cpu < 0 || shell_cpu >= CPU_SETSIZE)
+		{
+			return -1;
+		}
+		CPU_ZERO(&shell);
+		CPU_SET(shell_cpu, &shell);
+		if (sched_setaffinity(0, sizeof(shell), &shell) == -1)
+		{
+			return -1;
+		}
+		CPU_CLR(shell_cpu, &cpus);
+		if (CPU_COUNT(&cpus) == 0)
+		{
+			return -1;
+		}
+	}
+
+	if (policy == NANO_PLACEMENT_PACK)
+	{
+		nano_affinity_add(&cpus);
+	}
+	else if (policy == NANO_PLACEMENT_NUMA)
+	{
+		for (int node = 0; node < NANO_MAX_NODES; node++)
+		{
+			char path[64];
+			char buf[1024];
+			cpu_set_t node_cpus;
+			FILE *fileptr;
+
+			snprintf(path, sizeof(path), NANO_NODE_CPULIST, node);
+			if ((fileptr = fopen(path, "r")) == NULL)
+			{
+				continue;
+			}
+			if (fgets(buf, sizeof(buf), fileptr) != NULL && nano_affinity_parse_list(buf, &node_cpus) == 0)
+			{
+				CPU_AND(&node_cpus, &node_cpus, &cpus);
+				if (CPU_COUNT(&node_cpus) > 0)
+				{
+					nano_affinity_add(&node_cpus);
+				}
+			}
+			fclose(fileptr);
+		}
+		if (n_masks == 0)
+		{
+			nano_affinity_add(&cpus);
+		}
+	}
+	else
+	{
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &cpus))
+			{
+				cpu_set_t one;
+
+				CPU_ZERO(&one);
+				CPU_SET(cpu, &one);
+				nano_affinity_add(&one);
+			}
+		}
+	}
+
+	next_slot = mmap(NULL, sizeof(atomic_uint), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (next_slot == MAP_FAILED)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating the CPU slot counter\n");
+	}
+	atomic_init(next_slot, 0);
+	nano_affinity_enabled = 1;
+	DEBUG("%d CPU slot(s) for the commands, placement %d, shell on CPU %d", n_masks, policy, shell_cpu);
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_affinity_apply
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function sets the affinity of the calling process (the child, before exec) to the mask of the next 
+ * 		slot.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_affinity_apply(void)
+{
+	unsigned int slot;
+
+	if (!nano_affinity_enabled)
+	{
+		return;
+	}
+
+	slot = atomic_fetch_add(next_slot, 1) % (unsigned int)n_masks;
+	if (sched_setaffinity(0, sizeof(cpu_set_t), &masks[slot]) == -1)
+	{
+		WARNING("sched_setaffinity of slot %u: %s", slot, strerror(errno));
+	}
+}
@@ -0,0 +1,20 @@
+/**
+* @file affinity.h
+* @brief CPU placement of the commands and of nanoShell (--cpus, --placement, --shell-cpu)
+*/
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+/* Placement policies of --placement */
+#define NANO_PLACEMENT_RR 0	  // Each command on the next CPU of the list
+#define NANO_PLACEMENT_PACK 1 // All the commands on all the CPUs of the list
+#define NANO_PLACEMENT_NUMA 2 // Each command on the CPUs of the list in the next NUMA node
+
+extern int nano_affinity_enabled;
+
+int nano_affinity_parse_policy(const char *str);
+int nano_affinity_init(const char *list, int policy, int shell_cpu);
+void nano_affinity_apply(void);
+
+#endif /* AFFINITY_H */
@@ -27,25 +27,50 @@
 
 const char *gengetopt_args_info_purpose = "Simple example (optional)";
 
-const char *gengetopt_args_info_usage = "Usage: Example of .ggo file [OPTION]...";
+const char *gengetopt_args_info_usage = "Usage: Example of .ggo file [OPTION]... [COMMAND]...";
 
 const char *gengetopt_args_info_versiontext = "versiontext needed (optional)";
 
 const char *gengetopt_args_info_description = "description needed (optional)";
 
 const char *gengetopt_args_info_help[] = {
-  "      --help         Print help and exit",
-  "  -V, --version      Print version and exit",
-  "  -f, --file=STRING  folder",
-  "  -h, --no-help      help",
-  "  -m, --max=INT      Max executions",
-  "  -s, --signalfile   Signals file",
+  "      --help                  Print help and exit",
+  "  -V, --version               Print version and exit",
+  "  -f, --file=STRING           folder",
+  "  -c, --command=CMD           Executes the command line and terminates with its exit status",
+  "  -h, --no-help               help",
+  "  -m, --max=INT               Max executions",
+  "  -s, --signalfile            Signals file",
+  "      --trace=FILE            Chrome trace-event output file",
+  "      --record=FILE           Record the executed commands to a file",
+  "      --replay=FILE           Replay the commands of a recording",
+  "      --speed=DOUBLE          Replay speed factor (0 for as fast as possible)  (default=`1')",
+  "      --repeat=N              Execute the command given after -- N times and report its latency",
+  "      --rate=R/s              Launch rate (ex: 100/s): schedule of --repeat, token bucket otherwise",
+  "      --memstats              Per call site allocation statistics (dumped with SIGUSR2)",
+  "      --burst=B               Launches allowed at once by the --rate token bucket  (default=`1')",
+  "      --jobs=N                Runs the -f file as a DAG of #@id annotations on N workers",
+  "      --memo=DIR              Restores the redirect output of identical earlier runs from the cache DIR",
+  "      --memo-env=A,B          Environment variables in the keys of --memo",
+  "      --batch                 No prompt nor redirect messages, the default when stdin is not a terminal",
+  "      --journal=FILE          Writes the lines of -f completed, with their exit status, to FILE",
+  "      --resume                Skips the lines of -f completed with exit status 0 in the --journal",
+  "      --cpus=LIST             Pins the commands to the CPUs of LIST (ex: 0-3,8)",
+  "      --placement=POLICY      Placement of the commands on --cpus: rr, pack or numa  (default=`rr')",
+  "      --shell-cpu=CPU         Pins nanoShell to CPU, apart from the commands",
+  "      --nice=N                Niceness of the commands (-20 to 19)",
+  "      --ionice=CLASS[:LEVEL]  I/O scheduling class (rt, be or idle) and level (0-7) of the commands",
+  "      --metrics-socket=PATH   Serves the counters in the Prometheus text format on the Unix socket PATH",
+  "      --top=PID               Shows every second the counters of the nanoShell PID, read from its /dev/shm segment",
+  "      --watch                 Runs the -f file again each time it is written, only the lines changed and after them",
+  "      --capture=FILE          Appends the stdout and stderr of the commands to FILE as JSON lines",
     0
 };
 
 typedef enum {ARG_NO
   , ARG_STRING
   , ARG_INT
+  , ARG_DOUBLE
 } cmdline_parser_arg_type;
 
 static
@@ -67,9 +92,33 @@ void clear_given (struct gengetopt_args_info *args_info)
   args_info->help_given = 0 ;
   args_info->version_given = 0 ;
   args_info->file_given = 0 ;
+  args_info->command_given = 0 ;
   args_info->no_help_given = 0 ;
   args_info->max_given = 0 ;
   args_info->signalfile_given = 0 ;
+  args_info->trace_given = 0 ;
+  args_info->record_given = 0 ;
+  args_info->replay_given = 0 ;
+  args_info->speed_given = 0 ;
+  args_info->repeat_given = 0 ;
+  args_info->rate_given = 0 ;
+  args_info->memstats_given = 0 ;
+  args_info->burst_given = 0 ;
+  args_info->jobs_given = 0 ;
+  args_info->memo_given = 0 ;
+  args_info->memo_env_given = 0 ;
+  args_info->batch_given = 0 ;
+  args_info->journal_given = 0 ;
+  args_info->resume_given = 0 ;
+  args_info->cpus_given = 0 ;
+  args_info->placement_given = 0 ;
+  args_info->shell_cpu_given = 0 ;
+  args_info->nice_given = 0 ;
+  args_info->ionice_given = 0 ;
+  args_info->metrics_socket_given = 0 ;
+  args_info->top_given = 0 ;
+  args_info->watch_given = 0 ;
+  args_info->capture_given = 0 ;
 }
 
 static
@@ -78,7 +127,42 @@ void clear_args (struct gengetopt_args_info *args_info)
   FIX_UNUSED (args_info);
   args_info->file_arg = NULL;
   args_info->file_orig = NULL;
+  args_info->command_arg = NULL;
+  args_info->command_orig = NULL;
   args_info->max_orig = NULL;
+  args_info->trace_arg = NULL;
+  args_info->trace_orig = NULL;
+  args_info->record_arg = NULL;
+  args_info->record_orig = NULL;
+  args_info->replay_arg = NULL;
+  args_info->replay_orig = NULL;
+  args_info->speed_arg = 1;
+  args_info->speed_orig = NULL;
+  args_info->repeat_orig = NULL;
+  args_info->rate_arg = NULL;
+  args_info->rate_orig = NULL;
+  args_info->burst_arg = 1;
+  args_info->burst_orig = NULL;
+  args_info->jobs_orig = NULL;
+  args_info->memo_arg = NULL;
+  args_info->memo_orig = NULL;
+  args_info->memo_env_arg = NULL;
+  args_info->memo_env_orig = NULL;
+  args_info->journal_arg = NULL;
+  args_info->journal_orig = NULL;
+  args_info->cpus_arg = NULL;
+  args_info->cpus_orig = NULL;
+  args_info->placement_arg = gengetopt_strdup ("rr");
+  args_info->placement_orig = NULL;
+  args_info->shell_cpu_orig = NULL;
+  args_info->nice_orig = NULL;
+  args_info->ionice_arg = NULL;
+  args_info->ionice_orig = NULL;
+  args_info->metrics_socket_arg = NULL;
+  args_info->metrics_socket_orig = NULL;
+  args_info->top_orig = NULL;
+  args_info->capture_arg = NULL;
+  args_info->capture_orig = NULL;
   
 }
 
@@ -90,9 +174,33 @@ void init_args_info(struct gengetopt_args_info *args_info)
   args_info->help_help = gengetopt_args_info_help[0] ;
   args_info->version_help = gengetopt_args_info_help[1] ;
   args_info->file_help = gengetopt_args_info_help[2] ;
-  args_info->no_help_help = gengetopt_args_info_help[3] ;
-  args_info->max_help = gengetopt_args_info_help[4] ;
-  args_info->signalfile_help = gengetopt_args_info_help[5] ;
+  args_info->command_help = gengetopt_args_info_help[3] ;
+  args_info->no_help_help = gengetopt_args_info_help[4] ;
+  args_info->max_help = gengetopt_args_info_help[5] ;
+  args_info->signalfile_help = gengetopt_args_info_help[6] ;
+  args_info->trace_help = gengetopt_args_info_help[7] ;
+  args_info->record_help = gengetopt_args_info_help[8] ;
+  args_info->replay_help = gengetopt_args_info_help[9] ;
+  args_info->speed_help = gengetopt_args_info_help[10] ;
+  args_info->repeat_help = gengetopt_args_info_help[11] ;
+  args_info->rate_help = gengetopt_args_info_help[12] ;
+  args_info->memstats_help = gengetopt_args_info_help[13] ;
+  args_info->burst_help = gengetopt_args_info_help[14] ;
+  args_info->jobs_help = gengetopt_args_info_help[15] ;
+  args_info->memo_help = gengetopt_args_info_help[16] ;
+  args_info->memo_env_help = gengetopt_args_info_help[17] ;
+  args_info->batch_help = gengetopt_args_info_help[18] ;
+  args_info->journal_help = gengetopt_args_info_help[19] ;
+  args_info->resume_help = gengetopt_args_info_help[20] ;
+  args_info->cpus_help = gengetopt_args_info_help[21] ;
+  args_info->placement_help = gengetopt_args_info_help[22] ;
+  args_info->shell_cpu_help = gengetopt_args_info_help[23] ;
+  args_info->nice_help = gengetopt_args_info_help[24] ;
+  args_info->ionice_help = gengetopt_args_info_help[25] ;
+  args_info->metrics_socket_help = gengetopt_args_info_help[26] ;
+  args_info->top_help = gengetopt_args_info_help[27] ;
+  args_info->watch_help = gengetopt_args_info_help[28] ;
+  args_info->capture_help = gengetopt_args_info_help[29] ;
   
 }
 
@@ -143,6 +251,9 @@ cmdline_parser_init (struct gengetopt_args_info *args_info)
   clear_given (args_info);
   clear_args (args_info);
   init_args_info (args_info);
+
+  args_info->inputs = 0;
+  args_info->inputs_num = 0;
 }
 
 void
@@ -181,12 +292,50 @@ free_string_field (char **s)
 static void
 cmdline_parser_release (struct gengetopt_args_info *args_info)
 {
-
+  unsigned int i;
   free_string_field (&(args_info->file_arg));
   free_string_field (&(args_info->file_orig));
+  free_string_field (&(args_info->command_arg));
+  free_string_field (&(args_info->command_orig));
   free_string_field (&(args_info->max_orig));
+  free_string_field (&(args_info->trace_arg));
+  free_string_field (&(args_info->trace_orig));
+  free_string_field (&(args_info->record_arg));
+  free_string_field (&(args_info->record_orig));
+  free_string_field (&(args_info->replay_arg));
+  free_string_field (&(args_info->replay_orig));
+  free_string_field (&(args_info->speed_orig));
+  free_string_field (&(args_info->repeat_orig));
+  free_string_field (&(args_info->rate_arg));
+  free_string_field (&(args_info->rate_orig));
+  free_string_field (&(args_info->burst_orig));
+  free_string_field (&(args_info->jobs_orig));
+  free_string_field (&(args_info->memo_arg));
+  free_string_field (&(args_info->memo_orig));
+  free_string_field (&(args_info->memo_env_arg));
+  free_string_field (&(args_info->memo_env_orig));
+  free_string_field (&(args_info->journal_arg));
+  free_string_field (&(args_info->journal_orig));
+  free_string_field (&(args_info->cpus_arg));
+  free_string_field (&(args_info->cpus_orig));
+  free_string_field (&(args_info->placement_arg));
+  free_string_field (&(args_info->placement_orig));
+  free_string_field (&(args_info->shell_cpu_orig));
+  free_string_field (&(args_info->nice_orig));
+  free_string_field (&(args_info->ionice_arg));
+  free_string_field (&(args_info->ionice_orig));
+  free_string_field (&(args_info->metrics_socket_arg));
+  free_string_field (&(args_info->metrics_socket_orig));
+  free_string_field (&(args_info->top_orig));
+  free_string_field (&(args_info->capture_arg));
+  free_string_field (&(args_info->capture_orig));
   
   
+  for (i = 0; i < args_info->inputs_num; ++i)
+    free (args_info->inputs [i]);
+
+  if (args_info->inputs_num)
+    free (args_info->inputs);
 
   clear_given (args_info);
 }
@@ -221,12 +370,60 @@ cmdline_parser_dump(FILE *outfile, struct gengetopt_args_info *args_info)
     write_into_file(outfile, "version", 0, 0 );
   if (args_info->file_given)
     write_into_file(outfile, "file", args_info->file_orig, 0);
+  if (args_info->command_given)
+    write_into_file(outfile, "command", args_info->command_orig, 0);
   if (args_info->no_help_given)
     write_into_file(outfile, "no-help", 0, 0 );
   if (args_info->max_given)
     write_into_file(outfile, "max", args_info->max_orig, 0);
   if (args_info->signalfile_given)
     write_into_file(outfile, "signalfile", 0, 0 );
+  if (args_info->trace_given)
+    write_into_file(outfile, "trace", args_info->trace_orig, 0);
+  if (args_info->record_given)
+    write_into_file(outfile, "record", args_info->record_orig, 0);
+  if (args_info->replay_given)
+    write_into_file(outfile, "replay", args_info->replay_orig, 0);
+  if (args_info->speed_given)
+    write_into_file(outfile, "speed", args_info->speed_orig, 0);
+  if (args_info->repeat_given)
+    write_into_file(outfile, "repeat", args_info->repeat_orig, 0);
+  if (args_info->rate_given)
+    write_into_file(outfile, "rate", args_info->rate_orig, 0);
+  if (args_info->memstats_given)
+    write_into_file(outfile, "memstats", 0, 0 );
+  if (args_info->burst_given)
+    write_into_file(outfile, "burst", args_info->burst_orig, 0);
+  if (args_info->jobs_given)
+    write_into_file(outfile, "jobs", args_info->jobs_orig, 0);
+  if (args_info->memo_given)
+    write_into_file(outfile, "memo", args_info->memo_orig, 0);
+  if (args_info->memo_env_given)
+    write_into_file(outfile, "memo-env", args_info->memo_env_orig, 0);
+  if (args_info->batch_given)
+    write_into_file(outfile, "batch", 0, 0 );
+  if (args_info->journal_given)
+    write_into_file(outfile, "journal", args_info->journal_orig, 0);
+  if (args_info->resume_given)
+    write_into_file(outfile, "resume", 0, 0 );
+  if (args_info->cpus_given)
+    write_into_file(outfile, "cpus", args_info->cpus_orig, 0);
+  if (args_info->placement_given)
+    write_into_file(outfile, "placement", args_info->placement_orig, 0);
+  if (args_info->shell_cpu_given)
+    write_into_file(outfile, "shell-cpu", args_info->shell_cpu_orig, 0);
+  if (args_info->nice_given)
+    write_into_file(outfile, "nice", args_info->nice_orig, 0);
+  if (args_info->ionice_given)
+    write_into_file(outfile, "ionice", args_info->ionice_orig, 0);
+  if (args_info->metrics_socket_given)
+    write_into_file(outfile, "metrics-socket", args_info->metrics_socket_orig, 0);
+  if (args_info->top_given)
+    write_into_file(outfile, "top", args_info->top_orig, 0);
+  if (args_info->watch_given)
+    write_into_file(outfile, "watch", 0, 0 );
+  if (args_info->capture_given)
+    write_into_file(outfile, "capture", args_info->capture_orig, 0);
   
 
   i = EXIT_SUCCESS;
@@ -396,6 +593,9 @@ int update_arg(void *field, char **orig_field,
   case ARG_INT:
     if (val) *((int *)field) = strtol (val, &stop_char, 0);
     break;
+  case ARG_DOUBLE:
+    if (val) *((double *)field) = strtod (val, &stop_char);
+    break;
   case ARG_STRING:
     if (val) {
       string_field = (char **)field;
@@ -411,6 +611,7 @@ int update_arg(void *field, char **orig_field,
   /* check numeric conversion */
   switch(arg_type) {
   case ARG_INT:
+  case ARG_DOUBLE:
     if (val && !(stop_char && *stop_char == '\0')) {
       fprintf(stderr, "%s: invalid numeric value: %s\n", package_name, val);
       return 1; /* failure */
@@ -486,13 +687,37 @@ cmdline_parser_internal (
         { "help",	0, NULL, 0 },
         { "version",	0, NULL, 'V' },
         { "file",	1, NULL, 'f' },
+        { "command",	1, NULL, 'c' },
         { "no-help",	0, NULL, 'h' },
         { "max",	1, NULL, 'm' },
         { "signalfile",	0, NULL, 's' },
+        { "trace",	1, NULL, 0 },
+        { "record",	1, NULL, 0 },
+        { "replay",	1, NULL, 0 },
+        { "speed",	1, NULL, 0 },
+        { "repeat",	1, NULL, 0 },
+        { "rate",	1, NULL, 0 },
+        { "memstats",	0, NULL, 0 },
+        { "burst",	1, NULL, 0 },
+        { "jobs",	1, NULL, 0 },
+        { "memo",	1, NULL, 0 },
+        { "memo-env",	1, NULL, 0 },
+        { "batch",	0, NULL, 0 },
+        { "journal",	1, NULL, 0 },
+        { "resume",	0, NULL, 0 },
+        { "cpus",	1, NULL, 0 },
+        { "placement",	1, NULL, 0 },
+        { "shell-cpu",	1, NULL, 0 },
+        { "nice",	1, NULL, 0 },
+        { "ionice",	1, NULL, 0 },
+        { "metrics-socket",	1, NULL, 0 },
+        { "top",	1, NULL, 0 },
+        { "watch",	0, NULL, 0 },
+        { "capture",	1, NULL, 0 },
         { 0,  0, 0, 0 }
       };
 
-      c = getopt_long (argc, argv, "Vf:hm:s", long_options, &option_index);
+      c = getopt_long (argc, argv, "Vf:c:hm:s", long_options, &option_index);
 
       if (c == -1) break;	/* Exit from `while (1)' loop.  */
 
@@ -514,6 +739,18 @@ cmdline_parser_internal (
               additional_error))
             goto failure;
         
+          break;
+        case 'c':	/* Executes the command line and terminates with its exit status.  */
+        
+        
+          if (update_arg( (void *)&(args_info->command_arg), 
+               &(args_info->command_orig), &(args_info->command_given),
+              &(local_args_info.command_given), optarg, 0, 0, ARG_STRING,
+              check_ambiguity, override, 0, 0,
+              "command", 'c',
+              additional_error))
+            goto failure;
+        
           break;
         case 'h':	/* help.  */
         
@@ -559,6 +796,330 @@ cmdline_parser_internal (
             exit (EXIT_SUCCESS);
           }
 
+          /* Chrome trace-event output file.  */
+          if (strcmp (long_options[option_index].name, "trace") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->trace_arg), 
+                 &(args_info->trace_orig), &(args_info->trace_given),
+                &(local_args_info.trace_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "trace", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Record the executed commands to a file.  */
+          else if (strcmp (long_options[option_index].name, "record") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->record_arg), 
+                 &(args_info->record_orig), &(args_info->record_given),
+                &(local_args_info.record_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "record", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Replay the commands of a recording.  */
+          else if (strcmp (long_options[option_index].name, "replay") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->replay_arg), 
+                 &(args_info->replay_orig), &(args_info->replay_given),
+                &(local_args_info.replay_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "replay", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Replay speed factor (0 for as fast as possible).  */
+          else if (strcmp (long_options[option_index].name, "speed") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->speed_arg), 
+                 &(args_info->speed_orig), &(args_info->speed_given),
+                &(local_args_info.speed_given), optarg, 0, "1", ARG_DOUBLE,
+                check_ambiguity, override, 0, 0,
+                "speed", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Execute the command given after -- N times and report its latency.  */
+          else if (strcmp (long_options[option_index].name, "repeat") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->repeat_arg), 
+                 &(args_info->repeat_orig), &(args_info->repeat_given),
+                &(local_args_info.repeat_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "repeat", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Launch rate (ex: 100/s): schedule of --repeat, token bucket otherwise.  */
+          else if (strcmp (long_options[option_index].name, "rate") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->rate_arg), 
+                 &(args_info->rate_orig), &(args_info->rate_given),
+                &(local_args_info.rate_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "rate", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Per call site allocation statistics (dumped with SIGUSR2).  */
+          else if (strcmp (long_options[option_index].name, "memstats") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->memstats_given),
+                &(local_args_info.memstats_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "memstats", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Launches allowed at once by the --rate token bucket.  */
+          else if (strcmp (long_options[option_index].name, "burst") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->burst_arg), 
+                 &(args_info->burst_orig), &(args_info->burst_given),
+                &(local_args_info.burst_given), optarg, 0, "1", ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "burst", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Runs the -f file as a DAG of #@id annotations on N workers.  */
+          else if (strcmp (long_options[option_index].name, "jobs") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->jobs_arg), 
+                 &(args_info->jobs_orig), &(args_info->jobs_given),
+                &(local_args_info.jobs_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "jobs", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Restores the redirect output of identical earlier runs from the cache DIR.  */
+          else if (strcmp (long_options[option_index].name, "memo") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->memo_arg), 
+                 &(args_info->memo_orig), &(args_info->memo_given),
+                &(local_args_info.memo_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "memo", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Environment variables in the keys of --memo.  */
+          else if (strcmp (long_options[option_index].name, "memo-env") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->memo_env_arg), 
+                 &(args_info->memo_env_orig), &(args_info->memo_env_given),
+                &(local_args_info.memo_env_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "memo-env", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* No prompt nor redirect messages, the default when stdin is not a terminal.  */
+          else if (strcmp (long_options[option_index].name, "batch") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->batch_given),
+                &(local_args_info.batch_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "batch", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Writes the lines of -f completed, with their exit status, to FILE.  */
+          else if (strcmp (long_options[option_index].name, "journal") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->journal_arg), 
+                 &(args_info->journal_orig), &(args_info->journal_given),
+                &(local_args_info.journal_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "journal", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Skips the lines of -f completed with exit status 0 in the --journal.  */
+          else if (strcmp (long_options[option_index].name, "resume") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->resume_given),
+                &(local_args_info.resume_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "resume", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Pins the commands to the CPUs of LIST (ex: 0-3,8).  */
+          else if (strcmp (long_options[option_index].name, "cpus") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->cpus_arg), 
+                 &(args_info->cpus_orig), &(args_info->cpus_given),
+                &(local_args_info.cpus_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "cpus", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Placement of the commands on --cpus: rr, pack or numa.  */
+          else if (strcmp (long_options[option_index].name, "placement") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->placement_arg), 
+                 &(args_info->placement_orig), &(args_info->placement_given),
+                &(local_args_info.placement_given), optarg, 0, "rr", ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "placement", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Pins nanoShell to CPU, apart from the commands.  */
+          else if (strcmp (long_options[option_index].name, "shell-cpu") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->shell_cpu_arg), 
+                 &(args_info->shell_cpu_orig), &(args_info->shell_cpu_given),
+                &(local_args_info.shell_cpu_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "shell-cpu", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Niceness of the commands (-20 to 19).  */
+          else if (strcmp (long_options[option_index].name, "nice") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->nice_arg), 
+                 &(args_info->nice_orig), &(args_info->nice_given),
+                &(local_args_info.nice_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "nice", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* I/O scheduling class (rt, be or idle) and level (0-7) of the commands.  */
+          else if (strcmp (long_options[option_index].name, "ionice") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->ionice_arg), 
+                 &(args_info->ionice_orig), &(args_info->ionice_given),
+                &(local_args_info.ionice_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "ionice", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Serves the counters in the Prometheus text format on the Unix socket PATH.  */
+          else if (strcmp (long_options[option_index].name, "metrics-socket") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->metrics_socket_arg), 
+                 &(args_info->metrics_socket_orig), &(args_info->metrics_socket_given),
+                &(local_args_info.metrics_socket_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "metrics-socket", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Shows every second the counters of the nanoShell PID, read from its /dev/shm segment.  */
+          else if (strcmp (long_options[option_index].name, "top") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->top_arg), 
+                 &(args_info->top_orig), &(args_info->top_given),
+                &(local_args_info.top_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "top", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Runs the -f file again each time it is written, only the lines changed and after them.  */
+          else if (strcmp (long_options[option_index].name, "watch") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->watch_given),
+                &(local_args_info.watch_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "watch", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Appends the stdout and stderr of the commands to FILE as JSON lines.  */
+          else if (strcmp (long_options[option_index].name, "capture") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->capture_arg), 
+                 &(args_info->capture_orig), &(args_info->capture_given),
+                &(local_args_info.capture_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "capture", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          
+          break;
         case '?':	/* Invalid option.  */
           /* `getopt_long' already printed an error message.  */
           goto failure;
@@ -578,6 +1139,30 @@ cmdline_parser_internal (
   if ( error_occurred )
     return (EXIT_FAILURE);
 
+  if (optind < argc)
+    {
+      int i = 0 ;
+      int found_prog_name = 0;
+      /* whether program name, i.e., argv[0], is in the remaining args
+         (this may happen with some implementations of getopt,
+          but surely not with the one included by gengetopt) */
+
+      i = optind;
+      while (i < argc)
+        if (argv[i++] == argv[0]) {
+          found_prog_name = 1;
+          break;
+        }
+      i = 0;
+
+      args_info->inputs_num = argc - optind - found_prog_name;
+      args_info->inputs =
+        (char **)(malloc ((args_info->inputs_num)*sizeof(char *))) ;
+      while (optind < argc)
+        if (argv[optind++] != argv[0])
+          args_info->inputs[ i++ ] = gengetopt_strdup (argv[optind-1]) ;
+    }
+
   return 0;
 
 failure:
@@ -42,19 +42,109 @@ struct gengetopt_args_info
   char * file_arg;	/**< @brief folder.  */
   char * file_orig;	/**< @brief folder original value given at command line.  */
   const char *file_help; /**< @brief folder help description.  */
+  char * command_arg;	/**< @brief Executes the command line and terminates with its exit status.  */
+  char * command_orig;	/**< @brief Executes the command line and terminates with its exit status original value given at command line.  */
+  const char *command_help; /**< @brief Executes the command line and terminates with its exit status help description.  */
   const char *no_help_help; /**< @brief help help description.  */
   int max_arg;	/**< @brief Max executions.  */
   char * max_orig;	/**< @brief Max executions original value given at command line.  */
   const char *max_help; /**< @brief Max executions help description.  */
   const char *signalfile_help; /**< @brief Signals file help description.  */
+  char * trace_arg;	/**< @brief Chrome trace-event output file.  */
+  char * trace_orig;	/**< @brief Chrome trace-event output file original value given at command line.  */
+  const char *trace_help; /**< @brief Chrome trace-event output file help description.  */
+  char * record_arg;	/**< @brief Record the executed commands to a file.  */
+  char * record_orig;	/**< @brief Record the executed commands to a file original value given at command line.  */
+  const char *record_help; /**< @brief Record the executed commands to a file help description.  */
+  char * replay_arg;	/**< @brief Replay the commands of a recording.  */
+  char * replay_orig;	/**< @brief Replay the commands of a recording original value given at command line.  */
+  const char *replay_help; /**< @brief Replay the commands of a recording help description.  */
+  double speed_arg;	/**< @brief Replay speed factor (0 for as fast as possible) (default='1').  */
+  char * speed_orig;	/**< @brief Replay speed factor (0 for as fast as possible) original value given at command line.  */
+  const char *speed_help; /**< @brief Replay speed factor (0 for as fast as possible) help description.  */
+  int repeat_arg;	/**< @brief Execute the command given after -- N times and report its latency.  */
+  char * repeat_orig;	/**< @brief Execute the command given after -- N times and report its latency original value given at command line.  */
+  const char *repeat_help; /**< @brief Execute the command given after -- N times and report its latency help description.  */
+  char * rate_arg;	/**< @brief Launch rate (ex: 100/s): schedule of --repeat, token bucket otherwise.  */
+  char * rate_orig;	/**< @brief Launch rate (ex: 100/s): schedule of --repeat, token bucket otherwise original value given at command line.  */
+  const char *rate_help; /**< @brief Launch rate (ex: 100/s): schedule of --repeat, token bucket otherwise help description.  */
+  const char *memstats_help; /**< @brief Per call site allocation statistics (dumped with SIGUSR2) help description.  */
+  int burst_arg;	/**< @brief Launches allowed at once by the --rate token bucket (default='1').  */
+  char * burst_orig;	/**< @brief Launches allowed at once by the --rate token bucket original value given at command line.  */
+  const char *burst_help; /**< @brief Launches allowed at once by the --rate token bucket help description.  */
+  int jobs_arg;	/**< @brief Runs the -f file as a DAG of #@id annotations on N workers.  */
+  char * jobs_orig;	/**< @brief Runs the -f file as a DAG of #@id annotations on N workers original value given at command line.  */
+  const char *jobs_help; /**< @brief Runs the -f file as a DAG of #@id annotations on N workers help description.  */
+  char * memo_arg;	/**< @brief Restores the redirect output of identical earlier runs from the cache DIR.  */
+  char * memo_orig;	/**< @brief Restores the redirect output of identical earlier runs from the cache DIR original value given at command line.  */
+  const char *memo_help; /**< @brief Restores the redirect output of identical earlier runs from the cache DIR help description.  */
+  char * memo_env_arg;	/**< @brief Environment variables in the keys of --memo.  */
+  char * memo_env_orig;	/**< @brief Environment variables in the keys of --memo original value given at command line.  */
+  const char *memo_env_help; /**< @brief Environment variables in the keys of --memo help description.  */
+  const char *batch_help; /**< @brief No prompt nor redirect messages, the default when stdin is not a terminal help description.  */
+  char * journal_arg;	/**< @brief Writes the lines of -f completed, with their exit status, to FILE.  */
+  char * journal_orig;	/**< @brief Writes the lines of -f completed, with their exit status, to FILE original value given at command line.  */
+  const char *journal_help; /**< @brief Writes the lines of -f completed, with their exit status, to FILE help description.  */
+  const char *resume_help; /**< @brief Skips the lines of -f completed with exit status 0 in the --journal help description.  */
+  char * cpus_arg;	/**< @brief Pins the commands to the CPUs of LIST (ex: 0-3,8).  */
+  char * cpus_orig;	/**< @brief Pins the commands to the CPUs of LIST (ex: 0-3,8) original value given at command line.  */
+  const char *cpus_help; /**< @brief Pins the commands to the CPUs of LIST (ex: 0-3,8) help description.  */
+  char * placement_arg;	/**< @brief Placement of the commands on --cpus: rr, pack or numa (default='rr').  */
+  char * placement_orig;	/**< @brief Placement of the commands on --cpus: rr, pack or numa original value given at command line.  */
+  const char *placement_help; /**< @brief Placement of the commands on --cpus: rr, pack or numa help description.  */
+  int shell_cpu_arg;	/**< @brief Pins nanoShell to CPU, apart from the commands.  */
+  char * shell_cpu_orig;	/**< @brief Pins nanoShell to CPU, apart from the commands original value given at command line.  */
+  const char *shell_cpu_help; /**< @brief Pins nanoShell to CPU, apart from the commands help description.  */
+  int nice_arg;	/**< @brief Niceness of the commands (-20 to 19).  */
+  char * nice_orig;	/**< @brief Niceness of the commands (-20 to 19) original value given at command line.  */
+  const char *nice_help; /**< @brief Niceness of the commands (-20 to 19) help description.  */
+  char * ionice_arg;	/**< @brief I/O scheduling class (rt, be or idle) and level (0-7) of the commands.  */
+  char * ionice_orig;	/**< @brief I/O scheduling class (rt, be or idle) and level (0-7) of the commands original value given at command line.  */
+  const char *ionice_help; /**< @brief I/O scheduling class (rt, be or idle) and level (0-7) of the commands help description.  */
+  char * metrics_socket_arg;	/**< @brief Serves the counters in the Prometheus text format on the Unix socket PATH.  */
+  char * metrics_socket_orig;	/**< @brief Serves the counters in the Prometheus text format on the Unix socket PATH original value given at command line.  */
+  const char *metrics_socket_help; /**< @brief Serves the counters in the Prometheus text format on the Unix socket PATH help description.  */
+  int top_arg;	/**< @brief Shows every second the counters of the nanoShell PID, read from its /dev/shm segment.  */
+  char * top_orig;	/**< @brief Shows every second the counters of the nanoShell PID, read from its /dev/shm segment original value given at command line.  */
+  const char *top_help; /**< @brief Shows every second the counters of the nanoShell PID, read from its /dev/shm segment help description.  */
+  const char *watch_help; /**< @brief Runs the -f file again each time it is written, only the lines changed and after them help description.  */
+  char * capture_arg;	/**< @brief Appends the stdout and stderr of the commands to FILE as JSON lines.  */
+  char * capture_orig;	/**< @brief Appends the stdout and stderr of the commands to FILE as JSON lines original value given at command line.  */
+  const char *capture_help; /**< @brief Appends the stdout and stderr of the commands to FILE as JSON lines help description.  */
   
   unsigned int help_given ;	/**< @brief Whether help was given.  */
   unsigned int version_given ;	/**< @brief Whether version was given.  */
   unsigned int file_given ;	/**< @brief Whether file was given.  */
+  unsigned int command_given ;	/**< @brief Whether command was given.  */
   unsigned int no_help_given ;	/**< @brief Whether no-help was given.  */
   unsigned int max_given ;	/**< @brief Whether max was given.  */
   unsigned int signalfile_given ;	/**< @brief Whether signalfile was given.  */
+  unsigned int trace_given ;	/**< @brief Whether trace was given.  */
+  unsigned int record_given ;	/**< @brief Whether record was given.  */
+  unsigned int replay_given ;	/**< @brief Whether replay was given.  */
+  unsigned int speed_given ;	/**< @brief Whether speed was given.  */
+  unsigned int repeat_given ;	/**< @brief Whether repeat was given.  */
+  unsigned int rate_given ;	/**< @brief Whether rate was given.  */
+  unsigned int memstats_given ;	/**< @brief Whether memstats was given.  */
+  unsigned int burst_given ;	/**< @brief Whether burst was given.  */
+  unsigned int jobs_given ;	/**< @brief Whether jobs was given.  */
+  unsigned int memo_given ;	/**< @brief Whether memo was given.  */
+  unsigned int memo_env_given ;	/**< @brief Whether memo-env was given.  */
+  unsigned int batch_given ;	/**< @brief Whether batch was given.  */
+  unsigned int journal_given ;	/**< @brief Whether journal was given.  */
+  unsigned int resume_given ;	/**< @brief Whether resume was given.  */
+  unsigned int cpus_given ;	/**< @brief Whether cpus was given.  */
+  unsigned int placement_given ;	/**< @brief Whether placement was given.  */
+  unsigned int shell_cpu_given ;	/**< @brief Whether shell-cpu was given.  */
+  unsigned int nice_given ;	/**< @brief Whether nice was given.  */
+  unsigned int ionice_given ;	/**< @brief Whether ionice was given.  */
+  unsigned int metrics_socket_given ;	/**< @brief Whether metrics-socket was given.  */
+  unsigned int top_given ;	/**< @brief Whether top was given.  */
+  unsigned int watch_given ;	/**< @brief Whether watch was given.  */
+  unsigned int capture_given ;	/**< @brief Whether capture was given.  */
 
+  char **inputs ; /**< @brief unnamed options (options without names) */
+  unsigned inputs_num ; /**< @brief unnamed options number */
 } ;
 
 /** @brief The additional parameters to pass to parser functions */
@@ -0,0 +1,401 @@
+/**
+* @file capture.c
+* @brief JSONL capture of the stdout and stderr of the commands (--capture)
+*
+* The stdout and stderr of each command (the ones not redirected to a file) are pipes read by nanoShell with one
+* epoll loop while the command runs, in chunks of up to NANO_CAPTURE_CHUNK bytes. Each chunk is a JSON record:
+*
+*	{"line":3,"pid":1234,"stream":"stdout","ts":1603000000.123456,"data":"..."}
+*
+* "data" is the chunk as a JSON string when it is UTF-8 (a character split between two chunks goes with the 
+* second one), otherwise "data_base64" has the bytes in base64. The records are kept in a large buffer and 
+* written only as whole records, with O_APPEND, so the workers of --jobs can share the file. The pipes are 
+* enlarged, so a command writing fast is stalled only if the disk can't keep up.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "capture.h"
+#include "nanoShell.h"
+
+#define NANO_CAPTURE_CHUNK 65536		// Bytes read at once
+#define NANO_CAPTURE_PIPE_SIZE 1048576 // Capacity of the pipes (F_SETPIPE_SZ)
+#define NANO_CAPTURE_BUFSIZE (8 * NANO_CAPTURE_CHUNK) // A record is at most 6 times its chunk, plus the fields
+#define NANO_CAPTURE_CARRY 3			// Bytes of a UTF-8 character split between chunks
+
+int nano_capture_enabled = 0;
+unsigned int nano_capture_line = 0; // Line of the command (of the -f script, or read by the prompt)
+
+/* One captured stream of the running command */
+struct NanoCaptureStream {
+	const char *name;
+	int fds[2]; // Pipe, -1 if the stream isn't captured
+	size_t carry;
+	unsigned char chunk[NANO_CAPTURE_CARRY + NANO_CAPTURE_CHUNK];
+};
+
+static struct NanoCaptureStream streams[2] = {{.name = "stdout", .fds = {-1, -1}}, 
+											  {.name = "stderr", .fds = {-1, -1}}};
+static int capture_fd = -1;
+static int capture_epoll = -1;
+static pid_t capture_owner; // Children inherit the atexit handler
+static char *buffer;
+static size_t buffered;
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_flush
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the buffered records to the capture file.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_capture_flush(void)
+{
+	size_t written = 0;
+
+	while (written < buffered)
+	{
+		ssize_t n = write(capture_fd, buffer + written, buffered - written);
+
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			WARNING("Error writing the capture file: %s", strerror(errno));
+			break;
+		}
+		written += (size_t)n;
+	}
+	buffered = 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_close
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the last records and closes the capture file. Registered with atexit, it does nothing in
+ * 		the children that inherit the registration.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_capture_close(void)
+{
+	if (getpid() != capture_owner)
+	{
+		return;
+	}
+	nano_capture_flush();
+	close(capture_fd);
+	close(capture_epoll);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function opens the capture file @param path, appending to it, and enables the capture of the output of
+ * 		the commands.
+ * 
+ * @return Function returns 0 if OK or -1 if the file can't be opened
+ *******************************************************************************************************************/
+int nano_capture_open(const char *path)
+{
+	capture_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (capture_fd == -1)
+	{
+		return -1;
+	}
+	capture_epoll = epoll_create1(EPOLL_CLOEXEC);
+	buffer = MALLOC(NANO_CAPTURE_BUFSIZE);
+	if (capture_epoll == -1 || buffer == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating the capture of the output\n");
+	}
+	capture_owner = getpid();
+	nano_capture_enabled = 1;
+	atexit(nano_capture_close);
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_prepare
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function creates the pipes for the stdout and stderr of the next command, except the one redirected to
+ * 		a file by @param redirect (as returned by nano_verify_redirect).
+ * 
+ * @return Function returns 0 if OK or -1 if the pipes can't be created
+ *******************************************************************************************************************/
+int nano_capture_prepare(int redirect)
+{
+	for (int s = 0; s < 2; s++)
+	{
+		int redirected = s == 0 ? redirect == 1 || redirect == 2 : redirect == 3 || redirect == 4;
+
+		streams[s].carry = 0;
+		if (redirected)
+		{
+			continue;
+		}
+		if (pipe2(streams[s].fds, O_CLOEXEC) == -1)
+		{
+			if (s == 1 && streams[0].fds[0] != -1)
+			{
+				close(streams[0].fds[0]);
+				close(streams[0].fds[1]);
+				streams[0].fds[0] = streams[0].fds[1] = -1;
+			}
+			return -1;
+		}
+		fcntl(streams[s].fds[0], F_SETPIPE_SZ, NANO_CAPTURE_PIPE_SIZE);
+	}
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_child
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function makes the pipes the stdout and stderr of the command, in the child before exec.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_capture_child(void)
+{
+	for (int s = 0; s < 2; s++)
+	{
+		if (streams[s].fds[1] != -1 && dup2(streams[s].fds[1], s == 0 ? STDOUT_FILENO : STDERR_FILENO) == -1)
+		{
+			printf("[ERROR]Error redirecting %s\n", streams[s].name);
+		}
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_valid
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies that the @param size bytes of @param data are UTF-8, apart from a character not 
+ * 		complete at the end, whose first bytes are counted in @param partial.
+ * 
+ * @return Function returns 1 if the data is UTF-8 and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_capture_valid(const unsigned char *data, size_t size, size_t *partial)
+{
+	size_t i = 0;
+
+	*partial = 0;
+	while (i < size)
+	{
+		uint64_t word;
+		size_t length;
+
+		/* ASCII, the usual case, 8 bytes at a time */
+		if (i + sizeof(word) <= size)
+		{
+			memcpy(&word, data + i, sizeof(word));
+			if ((word & 0x8080808080808080ULL) == 0)
+			{
+				i += sizeof(word);
+				continue;
+			}
+		}
+		length = data[i] < 0x80 ? 1 : (data[i] & 0xE0) == 0xC0 && data[i] >= 0xC2 ? 2 : 
+				 (data[i] & 0xF0) == 0xE0 ? 3 : (data[i] & 0xF8) == 0xF0 && data[i] <= 0xF4 ? 4 : 0;
+
+		if (length == 0)
+		{
+			return 0;
+		}
+		for (size_t j = 1; j < length; j++)
+		{
+			if (i + j == size)
+			{
+				*partial = j;
+				return 1;
+			}
+			if ((data[i + j] & 0xC0) != 0x80)
+			{
+				return 0;
+			}
+		}
+		i += length;
+	}
+	return 1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_record
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function buffers the JSON record of the chunk @param data of @param size bytes, read from the stream 
+ * 		@param stream of the command @param pid. @param utf8 tells if it is written as a string or in base64.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_capture_record(pid_t pid, const char *stream, const unsigned char *data, size_t size, int utf8)
+{
+	static const char hex[] = "0123456789abcdef";
+	static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	struct timespec now;
+	char *out;
+
+	if (buffered + 6 * size + 256 > NANO_CAPTURE_BUFSIZE)
+	{
+		nano_capture_flush();
+	}
+	clock_gettime(CLOCK_REALTIME, &now);
+	out = buffer + buffered;
+	out += sprintf(out, "{\"line\":%u,\"pid\":%ld,\"stream\":\"%s\",\"ts\":%lld.%06ld,\"%s\":\"", nano_capture_line,
+				   (long)pid, stream, (long long)now.tv_sec, now.tv_nsec / 1000, utf8 ? "data" : "data_base64");
+
+	if (utf8)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			unsigned char c = data[i];
+
+			if (c >= 0x20 && c != '"' && c != '\\')
+			{
+				*out++ = (char)c;
+			}
+			else if (c == '"' || c == '\\' || c == '\n' || c == '\t' || c == '\r')
+			{
+				*out++ = '\\';
+				*out++ = c == '\n' ? 'n' : c == '\t' ? 't' : c == '\r' ? 'r' : (char)c;
+			}
+			else
+			{
+				memcpy(out, "\\u00", 4);
+				out[4] = hex[c >> 4];
+				out[5] = hex[c & 15];
+				out += 6;
+			}
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < size; i += 3)
+		{
+			uint32_t triple = (uint32_t)data[i] << 16 | (i + 1 < size ? (uint32_t)data[i + 1] << 8 : 0) | 
+							  (i + 2 < size ? data[i + 2] : 0);
+
+			*out++ = base64[triple >> 18 & 63];
+			*out++ = base64[triple >> 12 & 63];
+			*out++ = i + 1 < size ? base64[triple >> 6 & 63] : '=';
+			*out++ = i + 2 < size ? base64[triple & 63] : '=';
+		}
+	}
+	out += sprintf(out, "\"}\n");
+	buffered = (size_t)(out - buffer);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_read
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads a chunk of @param stream of the command @param pid and buffers its record. 
+ * 
+ * @return Function returns 1 if the stream ended (it is closed) and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_capture_read(struct NanoCaptureStream *stream, pid_t pid)
+{
+	ssize_t n = read(stream->fds[0], stream->chunk + stream->carry, NANO_CAPTURE_CHUNK);
+	size_t size;
+	size_t partial = 0;
+	int utf8;
+
+	if (n == -1 && (errno == EINTR || errno == EAGAIN))
+	{
+		return 0;
+	}
+	size = stream->carry + (n > 0 ? (size_t)n : 0);
+	utf8 = nano_capture_valid(stream->chunk, size, &partial);
+
+	/* Keep the start of a split character for the next chunk, unless it is the end */
+	if (n > 0 && utf8 && partial > 0)
+	{
+		size -= partial;
+	}
+	else
+	{
+		utf8 = utf8 && partial == 0;
+		partial = 0;
+	}
+	if (size > 0)
+	{
+		nano_capture_record(pid, stream->name, stream->chunk, size, utf8);
+	}
+	memmove(stream->chunk, stream->chunk + size, partial);
+	stream->carry = partial;
+
+	if (n <= 0)
+	{
+		epoll_ctl(capture_epoll, EPOLL_CTL_DEL, stream->fds[0], NULL);
+		close(stream->fds[0]);
+		stream->fds[0] = -1;
+		return 1;
+	}
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_capture_collect
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the captured streams of the command @param pid with epoll until it closes all of them
+ * 		(usually when it exits), and writes their records.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_capture_collect(pid_t pid)
+{
+	int remaining = 0;
+
+	for (int s = 0; s < 2; s++)
+	{
+		struct epoll_event event = {.events = EPOLLIN, .data.ptr = &streams[s]};
+
+		if (streams[s].fds[0] == -1)
+		{
+			continue;
+		}
+		close(streams[s].fds[1]);
+		streams[s].fds[1] = -1;
+		if (epoll_ctl(capture_epoll, EPOLL_CTL_ADD, streams[s].fds[0], &event) == -1)
+		{
+			ERROR(NANO_ERROR_IO, "Error capturing the %s of the command\n", streams[s].name);
+		}
+		remaining++;
+	}
+
+	while (remaining > 0)
+	{
+		struct epoll_event events[2];
+		int n = epoll_wait(capture_epoll, events, 2, -1);
+
+		if (n == -1 && errno != EINTR)
+		{
+			ERROR(NANO_ERROR_IO, "Error capturing the output of the command\n");
+		}
+		for (int e = 0; e < n; e++)
+		{
+			remaining -= nano_capture_read(events[e].data.ptr, pid);
+		}
+	}
+	nano_capture_flush();
+}
@@ -0,0 +1,19 @@
+/**
+* @file capture.h
+* @brief JSONL capture of the stdout and stderr of the commands (--capture)
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <sys/types.h>
+
+extern int nano_capture_enabled;
+extern unsigned int nano_capture_line;
+
+int nano_capture_open(const char *path);
+int nano_capture_prepare(int redirect);
+void nano_capture_child(void);
+void nano_capture_collect(pid_t pid);
+
+#endif /* CAPTURE_H */
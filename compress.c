@@ -0,0 +1,188 @@
+/**
+* @file compress.c
+* @brief Streaming compression of the >z and >>z redirects, with zstd or zlib
+*
+* The library is the one found at build time (the makefile links the same one): zstd if installed, otherwise
+* zlib in the gzip format, so the files can be read with zstdcat or zcat. Both formats can be concatenated, so
+* >>z appends a new frame (or gzip member) to the file. Without any of them >z is refused.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "debug.h"
+#include "compress.h"
+#include "nanoShell.h"
+
+#if defined(__has_include)
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define NANO_HAVE_ZSTD 1
+#elif __has_include(<zlib.h>)
+#include <zlib.h>
+#define NANO_HAVE_ZLIB 1
+#endif
+#endif
+
+#define NANO_COMPRESS_BUFSIZE 131072
+#define NANO_ZSTD_LEVEL 3
+#define NANO_ZLIB_LEVEL 6
+#define NANO_GZIP_WINDOW (15 + 16) // 32 KiB window with the gzip header and trailer
+
+#if defined(NANO_HAVE_ZSTD)
+const char *nano_compress_name = "zstd";
+#elif defined(NANO_HAVE_ZLIB)
+const char *nano_compress_name = "gzip";
+#else
+const char *nano_compress_name = NULL;
+#endif
+
+static unsigned char in_buffer[NANO_COMPRESS_BUFSIZE];
+static unsigned char out_buffer[NANO_COMPRESS_BUFSIZE];
+
+
+/*******************************************************************************************************************
+ * Function nano_compress_write
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the @param size bytes of @param buf to @param fd, counting them in @param stats.
+ * 
+ * @return Function returns 0 if OK and -1 for an error writing
+ *******************************************************************************************************************/
+static int nano_compress_write(int fd, const unsigned char *buf, size_t size, struct NanoCompressStats *stats)
+{
+	for (size_t done = 0; done < size;)
+	{
+		ssize_t n = write(fd, buf + done, size - done);
+
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	stats->out += size;
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_compress_read
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the next block of the output of the command from @param fd into the input buffer.
+ * 
+ * @return Function returns the number of bytes read, 0 at the end and -1 for an error reading
+ *******************************************************************************************************************/
+static ssize_t nano_compress_read(int fd, struct NanoCompressStats *stats)
+{
+	ssize_t n;
+
+	while ((n = read(fd, in_buffer, sizeof(in_buffer))) == -1 && errno == EINTR)
+		;
+	if (n > 0)
+	{
+		stats->in += (uint64_t)n;
+	}
+	return n;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_compress_stream
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function compresses everything read from @param in_fd (the pipe of the command) until its end, writing
+ * 		it to @param out_fd (the file), and saves the sizes and the time in @param stats.
+ * 
+ * @return Function returns 0 if OK and -1 for an error (or if nanoShell was built without a library)
+ *******************************************************************************************************************/
+int nano_compress_stream(int in_fd, int out_fd, struct NanoCompressStats *stats)
+{
+	uint64_t start = nano_time_ns();
+	int res = 0;
+
+	memset(stats, 0, sizeof(struct NanoCompressStats));
+
+#if defined(NANO_HAVE_ZSTD)
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+	ssize_t n;
+
+	if (cctx == NULL)
+	{
+		return -1;
+	}
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, NANO_ZSTD_LEVEL);
+
+	do
+	{
+		n = nano_compress_read(in_fd, stats);
+		ZSTD_EndDirective mode = n > 0 ? ZSTD_e_continue : ZSTD_e_end;
+		ZSTD_inBuffer input = {in_buffer, n > 0 ? (size_t)n : 0, 0};
+		size_t remaining;
+
+		/* With ZSTD_e_end it is called until the frame is complete */
+		do
+		{
+			ZSTD_outBuffer output = {out_buffer, sizeof(out_buffer), 0};
+
+			remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+			if (ZSTD_isError(remaining) || nano_compress_write(out_fd, out_buffer, output.pos, stats) == -1)
+			{
+				res = -1;
+				break;
+			}
+		} while (mode == ZSTD_e_end ? remaining != 0 : input.pos < input.size);
+	} while (n > 0 && res == 0);
+
+	ZSTD_freeCCtx(cctx);
+	res = n == -1 ? -1 : res;
+#elif defined(NANO_HAVE_ZLIB)
+	z_stream zs;
+	ssize_t n;
+	int flush;
+
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, NANO_ZLIB_LEVEL, Z_DEFLATED, NANO_GZIP_WINDOW, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return -1;
+	}
+
+	do
+	{
+		n = nano_compress_read(in_fd, stats);
+		flush = n > 0 ? Z_NO_FLUSH : Z_FINISH;
+		zs.next_in = in_buffer;
+		zs.avail_in = n > 0 ? (uInt)n : 0;
+
+		/* deflate is called until it doesn't fill the output buffer */
+		do
+		{
+			zs.next_out = out_buffer;
+			zs.avail_out = sizeof(out_buffer);
+			if (deflate(&zs, flush) == Z_STREAM_ERROR ||
+				nano_compress_write(out_fd, out_buffer, sizeof(out_buffer) - zs.avail_out, stats) == -1)
+			{
+				res = -1;
+				break;
+			}
+		} while (zs.avail_out == 0);
+	} while (flush != Z_FINISH && res == 0);
+
+	deflateEnd(&zs);
+	res = n == -1 ? -1 : res;
+#else
+	(void)in_fd;
+	(void)out_fd;
+	res = -1;
+#endif
+
+	stats->ns = nano_time_ns() - start;
+	return res;
+}
@@ -0,0 +1,21 @@
+/**
+* @file compress.h
+* @brief Streaming compression of the >z and >>z redirects, with zstd or zlib
+*/
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdint.h>
+
+struct NanoCompressStats {
+	uint64_t in;  // Bytes read from the command
+	uint64_t out; // Compressed bytes written to the file
+	uint64_t ns;  // Time until the end of the output of the command
+};
+
+extern const char *nano_compress_name;
+
+int nano_compress_stream(int in_fd, int out_fd, struct NanoCompressStats *stats);
+
+#endif /* COMPRESS_H */
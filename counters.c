@@ -0,0 +1,332 @@
+/**
+* @file counters.c
+* @brief Counters of the commands in a shared memory segment, read live with --top PID
+*
+* The counters are in /dev/shm/nanoShell.PID, so other tools can mmap it and read them with no syscalls and no 
+* signals to nanoShell. Each counter is atomic and updated with one atomic add, so a worker of --jobs or xargs -P 
+* that dies in the middle of an update never blocks the others; a reader may see a command counted before its
+* redirect, never a torn value. The segment is removed at exit and on SIGTERM, and the ones left by a nanoShell
+* that was killed or crashed are removed by the next nanoShell and by --top.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "counters.h"
+
+#define NANO_TOP_INTERVAL_NS 1000000000ULL // Refresh of --top
+#define NANO_SEGMENT_DIR "/dev/shm"
+
+static struct NanoSegment *segment;
+static char segment_name[64];
+static char segment_path[sizeof(NANO_SEGMENT_DIR) + 64]; // For unlink in the handler of SIGTERM (shm_unlink isn't async-signal-safe)
+static pid_t segment_owner; // Children inherit the atexit handler
+
+
+/*******************************************************************************************************************
+ * Function nano_counters_close
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function removes the segment from /dev/shm. Registered with atexit, it does nothing in the children 
+ * 		that inherit the registration. It is also called before nanoShell is replaced by its last command.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_counters_close(void)
+{
+	if (getpid() == segment_owner)
+	{
+		shm_unlink(segment_name);
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_counters_sigterm
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function removes the segment on SIGTERM, which skips the atexit handlers, and terminates nanoShell with
+ * 		the signal @param sig (the handler is reset when called). The workers, which inherit it, don't remove it.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_counters_sigterm(int sig)
+{
+	if (getpid() == segment_owner)
+	{
+		unlink(segment_path);
+	}
+	raise(sig);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_counters_sweep
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function removes from /dev/shm the segments of the nanoShells that no longer run (killed with SIGKILL 
+ * 		or crashed, so their segment wasn't removed).
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_counters_sweep(void)
+{
+	DIR *dir = opendir(NANO_SEGMENT_DIR);
+	struct dirent *entry;
+
+	if (dir == NULL)
+	{
+		return;
+	}
+	while ((entry = readdir(dir)) != NULL)
+	{
+		char name[64];
+		char *end;
+		long pid;
+
+		if (strncmp(entry->d_name, "nanoShell.", 10) != 0)
+		{
+			continue;
+		}
+		errno = 0;
+		pid = strtol(&entry->d_name[10], &end, 10);
+		if (errno != 0 || end == &entry->d_name[10] || *end != '\0' || pid <= 0)
+		{
+			continue;
+		}
+		if (kill((pid_t)pid, 0) == -1 && errno == ESRCH)
+		{
+			snprintf(name, sizeof(name), NANO_SEGMENT_NAME, pid);
+			if (shm_unlink(name) == 0)
+			{
+				DEBUG("removed the segment %s of a nanoShell that no longer runs", name);
+			}
+		}
+	}
+	closedir(dir);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_counters_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function creates the segment /dev/shm/nanoShell.PID with the counters. If it can't be created the
+ * 		counters are kept in anonymous shared memory, only for nanoShell and its workers.
+ * 
+ * @return Function returns the counters, all of them 0
+ *******************************************************************************************************************/
+struct NanoCounters *nano_counters_open(void)
+{
+	int fd;
+
+	segment_owner = getpid();
+	snprintf(segment_name, sizeof(segment_name), NANO_SEGMENT_NAME, (long)segment_owner);
+	snprintf(segment_path, sizeof(segment_path), NANO_SEGMENT_DIR "%s", segment_name);
+	nano_counters_sweep();
+
+	fd = shm_open(segment_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd != -1 && ftruncate(fd, sizeof(struct NanoSegment)) == 0)
+	{
+		segment = mmap(NULL, sizeof(struct NanoSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	else
+	{
+		segment = MAP_FAILED;
+	}
+	if (fd != -1)
+	{
+		close(fd);
+	}
+
+	if (segment == MAP_FAILED)
+	{
+		WARNING("Error creating /dev/shm%s, the counters can't be read with --top", segment_name);
+		if (fd != -1)
+		{
+			shm_unlink(segment_name);
+		}
+		segment = mmap(NULL, sizeof(struct NanoSegment), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, 
+					   -1, 0);
+		if (segment == MAP_FAILED)
+		{
+			ERROR(NANO_ERROR_MALLOC, "Error allocating the counters\n");
+		}
+	}
+	else
+	{
+		struct sigaction act;
+
+		memset(&act, 0, sizeof(act));
+		act.sa_handler = nano_counters_sigterm;
+		act.sa_flags = SA_RESETHAND;
+		sigemptyset(&act.sa_mask);
+		if (sigaction(SIGTERM, &act, NULL) < 0)
+		{
+			WARNING("Error handling SIGTERM, /dev/shm%s is left behind if nanoShell is terminated", segment_name);
+		}
+		atexit(nano_counters_close);
+	}
+
+	/* The magic is the last field written: a reader that finds it finds the rest of the header */
+	segment->version = NANO_SEGMENT_VERSION;
+	segment->size = sizeof(struct NanoSegment);
+	segment->pid = segment_owner;
+	segment->start_ns = nano_time_ns();
+	atomic_thread_fence(memory_order_release);
+	memcpy(segment->magic, NANO_SEGMENT_MAGIC, sizeof(NANO_SEGMENT_MAGIC));
+	return &segment->counters;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_counters_snapshot
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function copies the header and the counters of the segment @param shared to @param copy, each counter
+ * 		with one atomic load.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_counters_snapshot(struct NanoSegment *shared, struct NanoSegment *copy)
+{
+	copy->pid = shared->pid;
+	copy->start_ns = shared->start_ns;
+	copy->counters.G_count_stdout = shared->counters.G_count_stdout;
+	copy->counters.G_count_stderr = shared->counters.G_count_stderr;
+	copy->counters.G_count_commands = shared->counters.G_count_commands;
+	copy->counters.G_count_memo_hits = shared->counters.G_count_memo_hits;
+	copy->counters.G_count_memo_misses = shared->counters.G_count_memo_misses;
+	copy->counters.G_count_failures = shared->counters.G_count_failures;
+	copy->counters.G_count_inflight = shared->counters.G_count_inflight;
+	copy->counters.G_spawn_sum_ns = shared->counters.G_spawn_sum_ns;
+	for (int b = 0; b < NANO_SPAWN_BUCKETS; b++)
+	{
+		copy->counters.G_spawn_buckets[b] = shared->counters.G_spawn_buckets[b];
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_counters_percentile
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function prints the percentile @param p (0 to 100) of the spawn latency in @param values, as the limit 
+ * 		of the bucket where it is.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_counters_percentile(struct NanoCounters *values, int p)
+{
+	uint64_t total = 0;
+	uint64_t seen = 0;
+	int b;
+
+	for (b = 0; b < NANO_SPAWN_BUCKETS; b++)
+	{
+		total += values->G_spawn_buckets[b];
+	}
+	for (b = 0; b < NANO_SPAWN_BUCKETS - 1; b++)
+	{
+		seen += values->G_spawn_buckets[b];
+		if ((double)seen >= p / 100.0 * (double)total)
+		{
+			break;
+		}
+	}
+	if (b < NANO_SPAWN_BUCKETS - 1)
+	{
+		printf(", p%d <= %.3f ms", p, (double)(NANO_SPAWN_BUCKET_NS << b) / 1e6);
+	}
+	else
+	{
+		printf(", p%d > %.3f ms", p, (double)(NANO_SPAWN_BUCKET_NS << (b - 1)) / 1e6);
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_counters_top
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function shows the counters of the nanoShell @param pid every second, read from its segment, until it
+ * 		exits.
+ * 
+ * @return Function returns 0 when nanoShell exits or 1 if its segment can't be read
+ *******************************************************************************************************************/
+int nano_counters_top(pid_t pid)
+{
+	char name[64];
+	struct NanoSegment *shared;
+	struct NanoSegment now;
+	unsigned int last_commands = 0;
+	uint64_t last_ns = 0;
+	int fd;
+
+	nano_counters_sweep();
+	snprintf(name, sizeof(name), NANO_SEGMENT_NAME, (long)pid);
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1)
+	{
+		printf("[ERROR] Can't open /dev/shm%s: %s\n", name, strerror(errno));
+		return 1;
+	}
+	shared = mmap(NULL, sizeof(struct NanoSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shared == MAP_FAILED || memcmp(shared->magic, NANO_SEGMENT_MAGIC, sizeof(NANO_SEGMENT_MAGIC)) != 0 ||
+		shared->version != NANO_SEGMENT_VERSION || shared->size != sizeof(struct NanoSegment))
+	{
+		printf("[ERROR] /dev/shm%s isn't a segment of this version of nanoShell\n", name);
+		return 1;
+	}
+
+	while (kill(pid, 0) == 0 || errno == EPERM)
+	{
+		struct timespec interval = {.tv_sec = NANO_TOP_INTERVAL_NS / 1000000000ULL};
+		uint64_t ns = nano_time_ns();
+		uint64_t spawns = 0;
+
+		nano_counters_snapshot(shared, &now);
+		for (int b = 0; b < NANO_SPAWN_BUCKETS; b++)
+		{
+			spawns += now.counters.G_spawn_buckets[b];
+		}
+
+		if (isatty(STDOUT_FILENO))
+		{
+			printf("\033[H\033[2J");
+		}
+		printf("nanoShell %ld - up %.1f s\n", (long)now.pid, (double)(ns - now.start_ns) / 1e9);
+		printf("  commands      %10u  %10.1f/s\n", now.counters.G_count_commands, last_ns == 0 ? 0.0 : 
+			   (double)(now.counters.G_count_commands - last_commands) * 1e9 / (double)(ns - last_ns));
+		printf("  stdout redir  %10u\n", now.counters.G_count_stdout);
+		printf("  stderr redir  %10u\n", now.counters.G_count_stderr);
+		printf("  failures      %10u\n", now.counters.G_count_failures);
+		printf("  running       %10d\n", now.counters.G_count_inflight);
+		printf("  memo hit/miss %10u / %u\n", now.counters.G_count_memo_hits, now.counters.G_count_memo_misses);
+		if (spawns > 0)
+		{
+			printf("  spawn         %10.3f ms mean", (double)now.counters.G_spawn_sum_ns / 1e6 / (double)spawns);
+			nano_counters_percentile(&now.counters, 50);
+			nano_counters_percentile(&now.counters, 99);
+			printf("\n");
+		}
+		else
+		{
+			printf("  spawn         (measured with --trace or --metrics-socket)\n");
+		}
+		fflush(stdout);
+
+		last_commands = now.counters.G_count_commands;
+		last_ns = ns;
+		nanosleep(&interval, NULL);
+	}
+
+	munmap(shared, sizeof(struct NanoSegment));
+	return 0;
+}
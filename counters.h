@@ -0,0 +1,32 @@
+/**
+* @file counters.h
+* @brief Counters of the commands in a shared memory segment, read live with --top PID
+*/
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "nanoShell.h"
+
+#define NANO_SEGMENT_NAME "/nanoShell.%ld" // In /dev/shm, with the PID of nanoShell
+#define NANO_SEGMENT_MAGIC "NSHSEG"
+#define NANO_SEGMENT_VERSION 2
+
+/* Layout of the segment. Each counter is updated with one atomic add, by nanoShell and its workers */
+struct NanoSegment {
+	char magic[8];
+	uint32_t version;
+	uint32_t size;	   // sizeof(struct NanoSegment)
+	int64_t pid;
+	uint64_t start_ns; // CLOCK_MONOTONIC of the start of nanoShell
+	struct NanoCounters counters;
+};
+
+struct NanoCounters *nano_counters_open(void);
+void nano_counters_close(void);
+int nano_counters_top(pid_t pid);
+
+#endif /* COUNTERS_H */
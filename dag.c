@@ -0,0 +1,706 @@
+/**
+* @file dag.c
+* @brief Dependency-aware execution of -f scripts annotated with #@id (--jobs N)
+*
+* A comment line "#@id NAME [after A,B,...]" names the command line that follows it and declares the commands
+* it depends on. The script is run as a DAG on N workers: each command line is executed by a forked worker 
+* through the normal nano_exec_commands path as soon as all its predecessors exited with status 0. The commands
+* after a failed one are skipped. Lines without annotation don't depend on anything.
+*
+* The ready commands are kept in a binary heap ordered by their #@priority (see priority.c), then by their order
+* in the script, so the urgent ones overtake the bulk ones when the workers are busy.
+*
+* The critical path is computed with the measured duration of each command, so it is the time the script would
+* take with unlimited workers.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "dag.h"
+#include "memo.h"
+#include "journal.h"
+#include "watch.h"
+#include "capture.h"
+#include "record.h"
+#include "trace.h"
+#include "priority.h"
+#include "input.h"
+#include "nanoShell.h"
+
+/* State of a node of the DAG */
+#define NANO_DAG_WAITING 0
+#define NANO_DAG_RUNNING 1
+#define NANO_DAG_DONE 2
+#define NANO_DAG_FAILED 3
+#define NANO_DAG_SKIPPED 4
+
+/* One command line of the script */
+struct NanoDagNode {
+	char *line;
+	unsigned int number; // Line of the script, for --journal
+	char *id;	 // Name given with #@id, NULL if not annotated
+	char *after; // Names of the predecessors, until they are resolved
+	char *inputs; // Input files for --memo, given with #@inputs
+	struct NanoPriority prio;
+	size_t *preds;
+	size_t n_preds;
+	size_t remaining; // Predecessors not yet done
+	int state;
+	int exit_status;
+	pid_t pid;
+	uint64_t start;
+	uint64_t end;
+	uint64_t path;	   // Length of the longest path ending in this node
+	ssize_t path_prev; // Previous node in that path
+};
+
+struct NanoDag {
+	struct NanoDagNode *nodes;
+	size_t count;
+	size_t capacity;
+	size_t *ready; // Heap of the nodes without predecessors left
+	size_t n_ready;
+};
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_find
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function looks for the node of @param dag named @param id.
+ * 
+ * @return Function returns the index of the node or -1 if there isn't one
+ *******************************************************************************************************************/
+static ssize_t nano_dag_find(const struct NanoDag *dag, const char *id)
+{
+	for (size_t i = 0; i < dag->count; i++)
+	{
+		if (dag->nodes[i].id != NULL && strcmp(dag->nodes[i].id, id) == 0)
+		{
+			return (ssize_t)i;
+		}
+	}
+	return -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_add
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function appends the command @param line to @param dag, with the pending annotation @param id and
+ * 		@param after (both may be NULL), which are owned by the node from now on.
+ * 
+ * 		@param inputs is the pending #@inputs annotation, also owned by the node, and @param prio the priority.
+ * 
+ * @return Function returns 0 if OK and -1 if the memory couldn't be allocated
+ *******************************************************************************************************************/
+static int nano_dag_add(struct NanoDag *dag, const char *line, char *id, char *after, char *inputs,
+						const struct NanoPriority *prio)
+{
+	struct NanoDagNode *node;
+
+	if (dag->count == dag->capacity)
+	{
+		size_t capacity = dag->capacity ? dag->capacity * 2 : 16;
+		struct NanoDagNode *nodes = REALLOC(dag->nodes, capacity * sizeof(struct NanoDagNode));
+
+		if (nodes == NULL)
+		{
+			return -1;
+		}
+		dag->nodes = nodes;
+		dag->capacity = capacity;
+	}
+
+	node = &dag->nodes[dag->count];
+	memset(node, 0, sizeof(struct NanoDagNode));
+	node->line = STRDUP(line);
+	node->id = id;
+	node->after = after;
+	node->inputs = inputs;
+	node->prio = *prio;
+	node->path_prev = -1;
+	if (node->line == NULL)
+	{
+		return -1;
+	}
+	dag->count++;
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_parse
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the script @param fileptr into @param dag. The lines are skipped with the same rule of
+ * 		-f (starting with #, [LINE FEED], [SPACE] or [HORIZONTAL TAB]), except the #@id, #@inputs and
+ * 		#@priority annotations, which are kept for the next command line. After, the names of the 
+ * 		predecessors are resolved to nodes.
+ * 
+ * @return Function returns 0 if OK and -1 for a wrong annotation (the error is printed)
+ *******************************************************************************************************************/
+static int nano_dag_parse(FILE *fileptr, struct NanoDag *dag)
+{
+	char *lineptr = NULL;
+	size_t n = 0;
+	char *id = NULL;
+	char *after = NULL;
+	char *inputs = NULL;
+	struct NanoPriority prio;
+	unsigned int number = 0;
+	int res = 0;
+
+	nano_priority_default(&prio);
+
+	while (res == 0 && getline(&lineptr, &n, fileptr) != -1)
+	{
+		number++;
+		lineptr[strcspn(lineptr, "\n")] = 0;
+
+		if (strncmp(lineptr, NANO_DAG_ANNOTATION, strlen(NANO_DAG_ANNOTATION)) == 0)
+		{
+			char *save;
+			char *name = strtok_r(lineptr + strlen(NANO_DAG_ANNOTATION), NANO_DAG_DELIMITERS, &save);
+			char *keyword = strtok_r(NULL, NANO_DAG_DELIMITERS, &save);
+
+			if (name == NULL || (keyword != NULL && strcmp(keyword, "after") != 0))
+			{
+				printf("[ERROR] Wrong annotation at line %u: expected '#@id NAME [after A,B]'\n", number);
+				res = -1;
+				break;
+			}
+			if (id != NULL)
+			{
+				WARNING("annotation %s at line %u without a command", id, number);
+			}
+			FREE(id);
+			FREE(after);
+			id = STRDUP(name);
+			after = keyword != NULL && save != NULL ? STRDUP(save) : NULL;
+			if (nano_dag_find(dag, id) != -1)
+			{
+				printf("[ERROR] Duplicated id '%s' at line %u\n", id, number);
+				res = -1;
+			}
+		}
+		else if (strncmp(lineptr, NANO_MEMO_ANNOTATION, strlen(NANO_MEMO_ANNOTATION)) == 0)
+		{
+			FREE(inputs);
+			inputs = STRDUP(lineptr + strlen(NANO_MEMO_ANNOTATION));
+		}
+		else if (strncmp(lineptr, NANO_PRIORITY_ANNOTATION, strlen(NANO_PRIORITY_ANNOTATION)) == 0)
+		{
+			if (nano_priority_parse(lineptr + strlen(NANO_PRIORITY_ANNOTATION), &prio) == -1)
+			{
+				printf("[ERROR] Wrong annotation at line %u: expected '#@priority NICE [CLASS[:LEVEL]]'\n", number);
+				res = -1;
+			}
+		}
+		else if (lineptr[0] != 35 && lineptr[0] != 10 && lineptr[0] != 32 && lineptr[0] != 9 && lineptr[0] != 0)
+		{
+			if (nano_heredoc_count(lineptr) > 0)
+			{
+				printf("[ERROR] Here-documents aren't supported with --jobs (line %u)\n", number);
+				res = -1;
+				break;
+			}
+			if (nano_dag_add(dag, lineptr, id, after, inputs, &prio) == -1)
+			{
+				ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the DAG\n");
+			}
+			dag->nodes[dag->count - 1].number = number;
+			id = NULL;
+			after = NULL;
+			inputs = NULL;
+			nano_priority_default(&prio);
+		}
+	}
+	FREE(id);
+	FREE(after);
+	FREE(inputs);
+	free(lineptr);
+
+	for (size_t i = 0; res == 0 && i < dag->count; i++)
+	{
+		struct NanoDagNode *node = &dag->nodes[i];
+		char *save;
+
+		if (node->after == NULL)
+		{
+			continue;
+		}
+		node->preds = MALLOC((strlen(node->after) / 2 + 1) * sizeof(size_t));
+		if (node->preds == NULL)
+		{
+			ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the DAG\n");
+		}
+		for (char *name = strtok_r(node->after, NANO_DAG_DELIMITERS, &save); name != NULL;
+			 name = strtok_r(NULL, NANO_DAG_DELIMITERS, &save))
+		{
+			ssize_t pred = nano_dag_find(dag, name);
+
+			if (pred == -1)
+			{
+				printf("[ERROR] Unknown id '%s' after '%s'\n", name, node->id);
+				res = -1;
+				break;
+			}
+			node->preds[node->n_preds++] = (size_t)pred;
+		}
+		node->remaining = node->n_preds;
+	}
+
+	return res;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_acyclic
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies with Kahn's algorithm that the dependencies of @param dag don't have a cycle, which
+ * 		would leave its nodes waiting forever.
+ * 
+ * @return Function returns 1 if @param dag is acyclic and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_dag_acyclic(const struct NanoDag *dag)
+{
+	size_t *remaining = MALLOC((dag->count + 1) * sizeof(size_t));
+	size_t sorted = 0;
+	int progress = 1;
+
+	if (remaining == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the DAG\n");
+	}
+	for (size_t i = 0; i < dag->count; i++)
+	{
+		remaining[i] = dag->nodes[i].n_preds;
+	}
+
+	/* Removes the nodes without predecessors left until none is removed, O(V * E) is fine for a script */
+	while (progress)
+	{
+		progress = 0;
+		for (size_t i = 0; i < dag->count; i++)
+		{
+			if (remaining[i] != 0)
+			{
+				continue;
+			}
+			remaining[i] = (size_t)-1;
+			sorted++;
+			progress = 1;
+			for (size_t j = 0; j < dag->count; j++)
+			{
+				for (size_t p = 0; p < dag->nodes[j].n_preds; p++)
+				{
+					if (dag->nodes[j].preds[p] == i && remaining[j] != (size_t)-1)
+					{
+						remaining[j]--;
+					}
+				}
+			}
+		}
+	}
+
+	FREE(remaining);
+	return sorted == dag->count;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_name
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function gives the name of the node @param i of @param dag for the messages: its id, or its command 
+ * 		line if it isn't annotated.
+ * 
+ * @return Function returns the name of the node
+ *******************************************************************************************************************/
+static const char *nano_dag_name(const struct NanoDag *dag, size_t i)
+{
+	return dag->nodes[i].id != NULL ? dag->nodes[i].id : dag->nodes[i].line;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_skip
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function marks as skipped the nodes of @param dag that depend, directly or not, on the failed node 
+ * 		@param failed.
+ * 
+ * @return Function returns the number of skipped nodes
+ *******************************************************************************************************************/
+static size_t nano_dag_skip(struct NanoDag *dag, size_t failed)
+{
+	size_t skipped = 0;
+
+	for (size_t j = 0; j < dag->count; j++)
+	{
+		struct NanoDagNode *node = &dag->nodes[j];
+
+		for (size_t p = 0; node->state == NANO_DAG_WAITING && p < node->n_preds; p++)
+		{
+			if (node->preds[p] == failed)
+			{
+				node->state = NANO_DAG_SKIPPED;
+				printf("[skipped #%zu]: %s (after %s)\n", j + 1, node->line, nano_dag_name(dag, failed));
+				skipped += 1 + nano_dag_skip(dag, j);
+			}
+		}
+	}
+	return skipped;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_launch
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function starts the node @param i of @param dag in a forked worker, which executes its command line 
+ * 		with @param exec and exits with its exit status.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_dag_launch(struct NanoDag *dag, size_t i, int (*exec)(char *lineptr))
+{
+	struct NanoDagNode *node = &dag->nodes[i];
+
+	printf("[command #%zu]: %s\n", i + 1, node->line);
+
+	/* The worker would write again what is still in the buffer */
+	fflush(stdout);
+	fflush(stderr);
+
+	node->start = nano_time_ns();
+	node->pid = fork();
+	if (node->pid == -1)
+	{
+		ERROR(NANO_ERROR_FORK, "Error executing fork().\n");
+	}
+	else if (node->pid == 0)
+	{
+		nano_record_child();
+		nano_trace_child();
+		nano_memo_inputs(node->inputs);
+		nano_priority_set(&node->prio);
+		nano_capture_line = node->number;
+		exit(exec(node->line));
+	}
+	node->state = NANO_DAG_RUNNING;
+	DEBUG("dag node %s started (pid %d)", nano_dag_name(dag, i), (int)node->pid);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_before
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function compares the nodes @param a and @param b of @param dag for the heap of ready nodes.
+ * 
+ * @return Function returns 1 if @param a is launched before @param b and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_dag_before(const struct NanoDag *dag, size_t a, size_t b)
+{
+	int res = nano_priority_compare(&dag->nodes[a].prio, &dag->nodes[b].prio);
+
+	return res != 0 ? res < 0 : a < b;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_push
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds the node @param i to the heap of ready nodes of @param dag.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_dag_push(struct NanoDag *dag, size_t i)
+{
+	size_t pos = dag->n_ready++;
+
+	for (; pos > 0 && nano_dag_before(dag, i, dag->ready[(pos - 1) / 2]); pos = (pos - 1) / 2)
+	{
+		dag->ready[pos] = dag->ready[(pos - 1) / 2];
+	}
+	dag->ready[pos] = i;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_pop
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function removes the most urgent node from the heap of ready nodes of @param dag, which can't be empty.
+ * 
+ * @return Function returns the index of the node
+ *******************************************************************************************************************/
+static size_t nano_dag_pop(struct NanoDag *dag)
+{
+	size_t top = dag->ready[0];
+	size_t last = dag->ready[--dag->n_ready];
+	size_t pos = 0;
+
+	for (size_t child = 1; child < dag->n_ready; pos = child, child = 2 * child + 1)
+	{
+		if (child + 1 < dag->n_ready && nano_dag_before(dag, dag->ready[child + 1], dag->ready[child]))
+		{
+			child++;
+		}
+		if (!nano_dag_before(dag, dag->ready[child], last))
+		{
+			break;
+		}
+		dag->ready[pos] = dag->ready[child];
+	}
+	dag->ready[pos] = last;
+	return top;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_release
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function counts the node @param i of @param dag as done for the nodes after it, and adds to the heap
+ * 		the ones left without predecessors.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_dag_release(struct NanoDag *dag, size_t i)
+{
+	for (size_t j = 0; j < dag->count; j++)
+	{
+		for (size_t p = 0; p < dag->nodes[j].n_preds; p++)
+		{
+			if (dag->nodes[j].preds[p] == i && --dag->nodes[j].remaining == 0)
+			{
+				nano_dag_push(dag, j);
+			}
+		}
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_finish
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function saves the end of the node @param i of @param dag with the @param exit_status of its worker,
+ *		extends the longest path that ends in it and releases (or skips, if it failed) the nodes after it.
+ * 
+ * @return Function returns the number of nodes skipped because of it
+ *******************************************************************************************************************/
+static size_t nano_dag_finish(struct NanoDag *dag, size_t i, int exit_status)
+{
+	struct NanoDagNode *node = &dag->nodes[i];
+
+	node->end = nano_time_ns();
+	node->exit_status = exit_status;
+	node->state = exit_status == 0 ? NANO_DAG_DONE : NANO_DAG_FAILED;
+
+	/* Predecessors finished before the node started, so their paths are final */
+	for (size_t p = 0; p < node->n_preds; p++)
+	{
+		if (dag->nodes[node->preds[p]].path > node->path)
+		{
+			node->path = dag->nodes[node->preds[p]].path;
+			node->path_prev = (ssize_t)node->preds[p];
+		}
+	}
+	node->path += node->end - node->start;
+
+	printf("[done #%zu]: %s (exit status %d, %.3f s)\n", i + 1, nano_dag_name(dag, i), exit_status,
+		   (double)(node->end - node->start) / 1e9);
+	nano_journal_record(node->number, exit_status);
+	nano_watch_record(node->number, exit_status);
+
+	if (exit_status != 0)
+	{
+		return nano_dag_skip(dag, i);
+	}
+	nano_dag_release(dag, i);
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_report
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function prints the result of the run of @param dag that took @param elapsed ns on @param jobs workers: 
+ * 		the commands done, failed and skipped, the parallelism achieved and the critical path.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_dag_report(const struct NanoDag *dag, unsigned int jobs, uint64_t elapsed)
+{
+	size_t done = 0, failed = 0, skipped = 0;
+	uint64_t busy = 0;
+	ssize_t last = -1;
+
+	for (size_t i = 0; i < dag->count; i++)
+	{
+		const struct NanoDagNode *node = &dag->nodes[i];
+
+		done += node->state == NANO_DAG_DONE;
+		failed += node->state == NANO_DAG_FAILED;
+		skipped += node->state == NANO_DAG_SKIPPED;
+		if (node->state == NANO_DAG_DONE || node->state == NANO_DAG_FAILED)
+		{
+			busy += node->end - node->start;
+			if (last == -1 || node->path > dag->nodes[last].path)
+			{
+				last = (ssize_t)i;
+			}
+		}
+	}
+
+	printf("[INFO] %zu command(s) on %u worker(s): %zu done, %zu failed, %zu skipped in %.3f s (parallelism %.2f)\n",
+		   dag->count, jobs, done, failed, skipped, (double)elapsed / 1e9,
+		   elapsed > 0 ? (double)busy / (double)elapsed : 0.0);
+
+	if (last != -1)
+	{
+		/* The path is followed back from its end, so it is collected before being printed */
+		size_t *path = MALLOC(dag->count * sizeof(size_t));
+		size_t length = 0;
+
+		if (path == NULL)
+		{
+			ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the DAG\n");
+		}
+		for (ssize_t i = last; i != -1; i = dag->nodes[i].path_prev)
+		{
+			path[length++] = (size_t)i;
+		}
+
+		printf("[INFO] Critical path %.3f s: ", (double)dag->nodes[last].path / 1e9);
+		while (length-- > 0)
+		{
+			printf("%s%s", nano_dag_name(dag, path[length]), length > 0 ? " -> " : "\n");
+		}
+		FREE(path);
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_dag_run
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the script @param fileptr with its #@id annotations and runs it on @param jobs workers,
+ * 		starting each command line with @param exec as soon as its predecessors are done and a worker is free,
+ * 		by priority and then in the order of the script. At the end prints the critical path.
+ * 
+ * @return Function returns 0 if all the commands were done, 1 if any failed or was skipped and -1 for a wrong 
+ * 		script
+ *******************************************************************************************************************/
+int nano_dag_run(FILE *fileptr, unsigned int jobs, int (*exec)(char *lineptr))
+{
+	struct NanoDag dag = {NULL, 0, 0, NULL, 0};
+	size_t finished = 0;
+	unsigned int running = 0;
+	uint64_t start;
+	int res = 0;
+
+	if (nano_dag_parse(fileptr, &dag) == -1)
+	{
+		res = -1;
+	}
+	else if (!nano_dag_acyclic(&dag))
+	{
+		printf("[ERROR] The #@id annotations have a cycle\n");
+		res = -1;
+	}
+
+	/* A node is pushed once, when its last predecessor is released, or here if it has none */
+	if (res == 0 && (dag.ready = MALLOC((dag.count + 1) * sizeof(size_t))) == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the DAG\n");
+	}
+	for (size_t i = 0; res == 0 && i < dag.count; i++)
+	{
+		if (dag.nodes[i].n_preds == 0)
+		{
+			nano_dag_push(&dag, i);
+		}
+	}
+
+	/* The lines done in the run resumed with --journal, or unchanged with --watch, are done without being executed */
+	for (size_t i = 0; res == 0 && (nano_journal_enabled || nano_watch_enabled) && i < dag.count; i++)
+	{
+		if (nano_journal_done(dag.nodes[i].number) || nano_watch_done(dag.nodes[i].number))
+		{
+			printf("[%s #%zu]: %s\n", nano_watch_enabled ? "unchanged" : "resumed", i + 1, dag.nodes[i].line);
+			dag.nodes[i].state = NANO_DAG_DONE;
+			nano_dag_release(&dag, i);
+			finished++;
+		}
+	}
+
+	start = nano_time_ns();
+	while (res == 0 && finished < dag.count)
+	{
+		int wstatus;
+		pid_t pid;
+
+		/* The heap may have nodes done by --resume, which are dropped */
+		while (running < jobs && dag.n_ready > 0)
+		{
+			size_t i = nano_dag_pop(&dag);
+
+			if (dag.nodes[i].state == NANO_DAG_WAITING)
+			{
+				nano_dag_launch(&dag, i, exec);
+				running++;
+			}
+		}
+		if (running == 0)
+		{
+			break;
+		}
+
+		pid = waitpid(-1, &wstatus, 0);
+		if (pid == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			ERROR(NANO_ERROR_FORK, "Error waiting for the workers\n");
+		}
+		for (size_t i = 0; i < dag.count; i++)
+		{
+			if (dag.nodes[i].state == NANO_DAG_RUNNING && dag.nodes[i].pid == pid)
+			{
+				running--;
+				finished += 1 + nano_dag_finish(&dag, i, WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 
+												128 + WTERMSIG(wstatus));
+				break;
+			}
+		}
+	}
+
+	if (res == 0)
+	{
+		nano_dag_report(&dag, jobs, nano_time_ns() - start);
+		for (size_t i = 0; i < dag.count; i++)
+		{
+			res |= dag.nodes[i].state != NANO_DAG_DONE;
+		}
+	}
+
+	for (size_t i = 0; i < dag.count; i++)
+	{
+		FREE(dag.nodes[i].line);
+		FREE(dag.nodes[i].id);
+		FREE(dag.nodes[i].after);
+		FREE(dag.nodes[i].inputs);
+		FREE(dag.nodes[i].preds);
+	}
+	FREE(dag.nodes);
+	FREE(dag.ready);
+	return res;
+}
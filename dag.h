@@ -0,0 +1,16 @@
+/**
+* @file dag.h
+* @brief Dependency-aware execution of -f scripts annotated with #@id (--jobs N)
+*/
+
+#ifndef DAG_H
+#define DAG_H
+
+#include <stdio.h>
+
+#define NANO_DAG_ANNOTATION "#@id"
+#define NANO_DAG_DELIMITERS " \t,"
+
+int nano_dag_run(FILE *fileptr, unsigned int jobs, int (*exec)(char *lineptr));
+
+#endif /* DAG_H */
@@ -6,22 +6,239 @@
  * macros definidas no ficheiro debug.h. O objectivo destas funções 
  * é auxiliar o tratamento de erros e a depuração
  *
+ * Todas as mensagens são guardadas como registos binários num buffer
+ * circular (ver debug.h). As mensagens WARNING e ERROR continuam a ser
+ * também escritas no stderr.
+ *
  * @author Miguel Frade, Patricio Domingues, Vitor Carreira
- * @version 2 
+ * @version 3 
  */
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <netdb.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "debug.h"
 
+/** Número de registos do buffer circular (potência de 2) */
+#define NANO_LOG_RECORDS 4096
+
+/** Número de formatos diferentes que podem ser registados (potência de 2) */
+#define NANO_LOG_SITES 256
+
+/** Local de uma chamada DEBUG/WARNING/ERROR, com os tipos dos argumentos */
+struct NanoLogSite {
+	const char *fmt;
+	const char *file;
+	int line;
+	int nargs;
+	char types[NANO_LOG_MAXARGS];
+};
+
+#ifdef SHOW_DEBUG
+volatile sig_atomic_t nano_log_level = NANO_LOG_DEBUG;
+#else
+volatile sig_atomic_t nano_log_level = NANO_LOG_WARNING;
+#endif
+
+static struct NanoLogSite sites[NANO_LOG_SITES];
+static struct NanoLogRecord ring[NANO_LOG_RECORDS];
+static uint64_t ring_head;
+
+/**
+ * Analisa a string de formatação e guarda em specs a posição e o
+ * tipo de cada conversão. As conversões com '*', %n e long double
+ * (%Lf) não são suportadas.
+ *
+ * @param fmt string de formatação como no "printf"
+ * @param specs vector onde são guardadas as conversões
+ * @param max tamanho do vector specs
+ * @return O número de conversões ou -1 se a string não é suportada
+ */
+int nano_log_parse_format(const char *fmt, struct NanoLogSpec *specs, int max)
+{
+    int count = 0;
+
+    for (size_t i = 0; fmt[i] != 0; i++) {
+        size_t start = i;
+        char length = 0;
+        char type;
+
+        if (fmt[i] != '%')
+            continue;
+        i++;
+        if (fmt[i] == '%')
+            continue;
+
+        while (fmt[i] != 0 && strchr("-+ #0'", fmt[i]) != NULL)
+            i++;
+        while (isdigit((unsigned char)fmt[i]) || fmt[i] == '.')
+            i++;
+        if (fmt[i] == '*')
+            return -1;
+
+        if (fmt[i] == 'h') {
+            i++;
+            if (fmt[i] == 'h')
+                i++;
+        } else if (fmt[i] == 'l') {
+            length = 'l';
+            i++;
+            if (fmt[i] == 'l') {
+                length = 'L';
+                i++;
+            }
+        } else if (fmt[i] == 'z' || fmt[i] == 'j' || fmt[i] == 't') {
+            length = fmt[i++];
+        } else if (fmt[i] == 'L') {
+            /* long double não cabe nos 8 bytes de um argumento */
+            return -1;
+        }
+
+        switch (fmt[i]) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+            type = length != 0 ? length : 'i';
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            type = 'd';
+            break;
+        case 's':
+            type = 's';
+            break;
+        case 'p':
+            type = 'p';
+            break;
+        default:
+            return -1;
+        }
+
+        if (count == max)
+            return -1;
+        specs[count].start = start;
+        specs[count].end = i + 1;
+        specs[count].type = type;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Procura (ou regista na primeira chamada) o local da mensagem.
+ *
+ * @return O identificador do local ou -1 se a tabela está cheia
+ */
+static int nano_log_site(const char *file, int line, const char *fmt)
+{
+    size_t slot = (((uintptr_t)fmt >> 3) ^ (size_t)line) & (NANO_LOG_SITES - 1);
+
+    for (size_t n = 0; n < NANO_LOG_SITES; n++, slot = (slot + 1) & (NANO_LOG_SITES - 1)) {
+        struct NanoLogSite *site = &sites[slot];
+
+        if (site->fmt == fmt && site->line == line && site->file == file)
+            return (int)slot;
+
+        if (site->fmt == NULL) {
+            struct NanoLogSpec specs[NANO_LOG_MAXARGS];
+            int nargs = nano_log_parse_format(fmt, specs, NANO_LOG_MAXARGS);
+
+            for (int i = 0; i < nargs; i++)
+                site->types[i] = specs[i].type;
+            site->nargs = nargs;
+            site->file = file;
+            site->line = line;
+            site->fmt = fmt;
+            return (int)slot;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Guarda a mensagem num registo binário do buffer circular. Os
+ * argumentos não são formatados, apenas copiados.
+ *
+ * @param level nível da mensagem
+ * @param err valor de errno no momento da chamada
+ * @return A função não retorna nada
+ */
+static void nano_log_write(int level, int err, const char *file, int line, const char *fmt, va_list ap)
+{
+    struct NanoLogRecord *rec;
+    struct NanoLogSite *site;
+    struct timespec now;
+    size_t pos = 0;
+    int slot = nano_log_site(file, line, fmt);
+
+    if (slot == -1)
+        return;
+    site = &sites[slot];
+
+    rec = &ring[ring_head++ & (NANO_LOG_RECORDS - 1)];
+    clock_gettime(CLOCK_REALTIME, &now);
+    rec->time = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    rec->site = (uint16_t)slot;
+    rec->level = (uint8_t)level;
+    rec->err = err;
+    rec->nargs = 0;
+
+    for (int i = 0; i < site->nargs; i++) {
+        int64_t integer = 0;
+        double real;
+        const char *str;
+        size_t len;
+
+        if (site->types[i] == 's') {
+            str = va_arg(ap, const char *);
+            if (str == NULL)
+                str = "(null)";
+            len = strlen(str);
+            if (pos + 1 >= NANO_LOG_ARGS_SIZE)
+                break;
+            if (len > NANO_LOG_ARGS_SIZE - pos - 1)
+                len = NANO_LOG_ARGS_SIZE - pos - 1;
+            if (len > 255)
+                len = 255;
+            rec->args[pos] = (unsigned char)len;
+            memcpy(&rec->args[pos + 1], str, len);
+            pos += len + 1;
+            rec->nargs++;
+            continue;
+        }
+
+        switch (site->types[i]) {
+        case 'l': integer = va_arg(ap, long); break;
+        case 'L': integer = va_arg(ap, long long); break;
+        case 'z': integer = (int64_t)va_arg(ap, size_t); break;
+        case 'j': integer = va_arg(ap, intmax_t); break;
+        case 't': integer = va_arg(ap, ptrdiff_t); break;
+        case 'p': integer = (int64_t)(uintptr_t)va_arg(ap, void *); break;
+        case 'd':
+            real = va_arg(ap, double);
+            memcpy(&integer, &real, sizeof(real));
+            break;
+        default: integer = va_arg(ap, int); break;
+        }
+
+        if (pos + 8 > NANO_LOG_ARGS_SIZE)
+            break;
+        memcpy(&rec->args[pos], &integer, 8);
+        pos += 8;
+        rec->nargs++;
+    }
+}
+
 /**
  * Esta função deve ser utilizada para auxiliar a depuração de programas.
  * Esta função <b>não deve</b> ser chamada directamente, mas sim através
- * da macro DEBUG().
+ * da macro DEBUG(). A mensagem só é guardada no buffer circular.
  *
  * @param file nome do ficheiro
  * 	       (através da macro DEBUG)
@@ -35,13 +252,11 @@
 void debug(const char *file, const int line, char *fmt, ...)
 {
     va_list ap;
+    int err = errno;
 
     va_start(ap, fmt);
-    fprintf(stderr, "[%s@%d] DEBUG - ", file, line);
-    vfprintf(stderr, fmt, ap);
+    nano_log_write(NANO_LOG_DEBUG, err, file, line, fmt, ap);
     va_end(ap);
-    fprintf(stderr, "\n");
-    fflush(stderr);
 }
 
 
@@ -63,12 +278,20 @@ void debug(const char *file, const int line, char *fmt, ...)
 void warning(const char *file, const int line, char *fmt, ...)
 {
     va_list ap;
+    int err = errno;
+
+    if (nano_log_level < NANO_LOG_WARNING)
+        return;
+
+    va_start(ap, fmt);
+    nano_log_write(NANO_LOG_WARNING, err, file, line, fmt, ap);
+    va_end(ap);
 
     va_start(ap, fmt);
     fprintf(stderr, "[%s@%d] WARNING - ", file, line);
     vfprintf(stderr, fmt, ap);
     va_end(ap);
-    fprintf(stderr, ": %s\n", strerror(errno));
+    fprintf(stderr, ": %s\n", strerror(err));
     fflush(stderr);
 }
 
@@ -93,16 +316,100 @@ void warning(const char *file, const int line, char *fmt, ...)
 void error(const char *file, const int line, int exitCode, char *fmt, ...)
 {
     va_list ap;
+    int err = errno;
+
+    va_start(ap, fmt);
+    nano_log_write(NANO_LOG_ERROR, err, file, line, fmt, ap);
+    va_end(ap);
 
     va_start(ap, fmt);
     fprintf(stderr, "[%s@%d] ERROR - ", file, line);
     vfprintf(stderr, fmt, ap);
     va_end(ap);
-    fprintf(stderr, ": %s\n", strerror(errno));
+    fprintf(stderr, ": %s\n", strerror(err));
     fflush(stderr);
     exit(exitCode);
 }
 
+/**
+ * Muda o nível de registo a partir de um sinal. Se o sinal foi enviado
+ * com sigqueue() o valor enviado é o novo nível, caso contrário (kill)
+ * o nível passa para o seguinte: ERROR -> WARNING -> DEBUG -> ERROR.
+ * Pode ser chamada dentro de um signal handler.
+ *
+ * @param siginfo informação do sinal recebido
+ * @return A função não retorna nada
+ */
+void nano_log_signal(const siginfo_t *siginfo)
+{
+    if (siginfo->si_code == SI_QUEUE) {
+        int level = siginfo->si_value.sival_int;
+
+        if (level >= NANO_LOG_ERROR && level <= NANO_LOG_DEBUG)
+            nano_log_level = level;
+    } else {
+        nano_log_level = (nano_log_level + 1) % (NANO_LOG_DEBUG + 1);
+    }
+}
+
+/**
+ * Escreve os registos do buffer circular (do mais antigo para o mais
+ * recente) no ficheiro path, precedidos da tabela de formatos, para
+ * serem convertidos em texto pelo programa nanoShell-logdecode.
+ * Só usa write(), para poder ser chamada dentro de um signal handler.
+ *
+ * @param path nome do ficheiro a criar
+ * @return 0 se OK, -1 em caso de erro
+ */
+int nano_log_dump(const char *path)
+{
+    uint32_t nsites = 0;
+    uint32_t size = NANO_LOG_RECORD_SIZE;
+    uint64_t first = ring_head > NANO_LOG_RECORDS ? ring_head - NANO_LOG_RECORDS : 0;
+    uint64_t count = ring_head - first;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd == -1)
+        return -1;
+
+    for (size_t i = 0; i < NANO_LOG_SITES; i++)
+        if (sites[i].fmt != NULL)
+            nsites++;
+
+    if (write(fd, NANO_LOG_MAGIC, 8) != 8 || write(fd, &nsites, 4) != 4 ||
+        write(fd, &size, 4) != 4 || write(fd, &count, 8) != 8)
+        goto failure;
+
+    /* site: u16 id, u16 tamanho do ficheiro, u16 tamanho do formato, u16 0, i32 linha, ficheiro, formato */
+    for (size_t i = 0; i < NANO_LOG_SITES; i++) {
+        uint16_t head[4];
+        int32_t line;
+
+        if (sites[i].fmt == NULL)
+            continue;
+        head[0] = (uint16_t)i;
+        head[1] = (uint16_t)strlen(sites[i].file);
+        head[2] = (uint16_t)strlen(sites[i].fmt);
+        head[3] = 0;
+        line = sites[i].line;
+        if (write(fd, head, sizeof(head)) != sizeof(head) || write(fd, &line, 4) != 4 ||
+            write(fd, sites[i].file, head[1]) != head[1] || write(fd, sites[i].fmt, head[2]) != head[2])
+            goto failure;
+    }
+
+    for (uint64_t n = first; n < ring_head; n++) {
+        if (write(fd, &ring[n & (NANO_LOG_RECORDS - 1)], size) != (ssize_t)size)
+            goto failure;
+    }
+
+    close(fd);
+    return 0;
+
+failure:
+    close(fd);
+    return -1;
+}
+
 void show_bytes(char *ptr, size_t num_bytes){
 	unsigned char *work_ptr = (unsigned char*)ptr;
 	for(size_t i=0;i<num_bytes;i++){
@@ -10,26 +10,83 @@
  * DEBUG("i = %d e f=.2f%", i, f);
  * ERROR("%s", msg);
  * @endcode
+ *
+ * As mensagens são guardadas em registos binários de tamanho fixo num
+ * buffer circular do processo (identificador do formato + argumentos),
+ * sem formatação de texto. O buffer é escrito para ficheiro com
+ * nano_log_dump() e convertido para texto pelo programa
+ * nanoShell-logdecode. O nível de registo pode ser mudado em execução
+ * (ver nano_log_signal()).
  * @author Miguel Frade, Patricio Domingues, Vitor Carreira
- * @version 2
+ * @version 3
  */
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+
+/** Níveis de registo */
+#define NANO_LOG_ERROR 0
+#define NANO_LOG_WARNING 1
+#define NANO_LOG_DEBUG 2
+
+/** Tamanho de cada registo binário e espaço para os argumentos */
+#define NANO_LOG_RECORD_SIZE 128
+#define NANO_LOG_ARGS_SIZE (NANO_LOG_RECORD_SIZE - 16)
+
+/** Número máximo de conversões (%) numa string de formatação */
+#define NANO_LOG_MAXARGS 16
+
+/** Cabeçalho dos ficheiros criados por nano_log_dump() */
+#define NANO_LOG_MAGIC "NSHLOG1\n"
+
+/**
+ * Registo binário guardado no buffer circular. Os argumentos são
+ * guardados pela ordem da string de formatação: inteiros, reais e
+ * ponteiros em 8 bytes, strings com 1 byte de tamanho seguido dos
+ * caracteres (truncadas ao espaço disponível).
+ */
+struct NanoLogRecord {
+	uint64_t time;			/**< CLOCK_REALTIME em nanossegundos */
+	uint16_t site;			/**< identificador do formato (ficheiro, linha, formato) */
+	uint8_t level;			/**< nível da mensagem */
+	uint8_t nargs;			/**< número de argumentos guardados */
+	int32_t err;			/**< valor de errno na chamada */
+	unsigned char args[NANO_LOG_ARGS_SIZE];
+};
+
+/** Conversão de uma string de formatação */
+struct NanoLogSpec {
+	size_t start;			/**< posição do '%' */
+	size_t end;				/**< posição seguinte ao especificador */
+	char type;				/**< i, l, L, z, j, t (inteiros), d (real), s (string), p (ponteiro) */
+};
+
+extern volatile sig_atomic_t nano_log_level;
+
 void debug(const char *file, const int line, char *fmt, ...);
 void warning(const char *file, const int line, char *fmt, ...);
 void error(const char *file, const int line, int exitCode, char *fmt, ...);
 void show_bytes(char *ptr, size_t num_bytes);
+int nano_log_parse_format(const char *fmt, struct NanoLogSpec *specs, int max);
+void nano_log_signal(const siginfo_t *siginfo);
+int nano_log_dump(const char *path);
 
 /**
- * Macro para imprimir no stderr informações úteis 
- * para depuração. O número de parâmetros de entrada
- * é variável.
+ * Macro para registar informações úteis para depuração.
+ * O número de parâmetros de entrada é variável. Os parâmetros
+ * só são avaliados se o nível de registo atual for NANO_LOG_DEBUG.
  * 
  * @return A função não retorna nada
  * @see debug()
  */
-#define DEBUG(...) debug(__FILE__, __LINE__, __VA_ARGS__)
+#define DEBUG(...) \
+	do { \
+		if (nano_log_level >= NANO_LOG_DEBUG) \
+			debug(__FILE__, __LINE__, __VA_ARGS__); \
+	} while (0)
 
 
 /**
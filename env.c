@@ -0,0 +1,168 @@
+/**
+* @file env.c
+* @brief Environment overlays for commands started with NAME=value assignments
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "env.h"
+#include "nanoShell.h"
+
+extern char **environ;
+
+/* Cached base environment, handed to execvpe as is when there are no assignments */
+static char **env_base;
+static size_t env_count;
+
+
+/*******************************************************************************************************************
+ * Function nano_env_init
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function caches the base environment array of nanoShell and its size. It must be called again every
+ * 		time the environment of nanoShell changes (nano_env_export does it).
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_env_init(void)
+{
+	env_base = environ;
+	env_count = 0;
+
+	while (env_base[env_count] != NULL)
+	{
+		env_count++;
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_env_name_length
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies if @param str is a NAME=value assignment, where NAME starts with a letter or _ and
+ * 		only has letters, digits and _.
+ * 
+ * @return Function returns the length of NAME or 0 if @param str isn't an assignment
+ *******************************************************************************************************************/
+static size_t nano_env_name_length(const char *str)
+{
+	size_t i = 0;
+
+	if (!isalpha((unsigned char)str[0]) && str[0] != '_')
+	{
+		return 0;
+	}
+
+	while (isalnum((unsigned char)str[i]) || str[i] == '_')
+	{
+		i++;
+	}
+
+	return str[i] == '=' ? i : 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_env_assignments
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function counts the leading NAME=value assignments of the command in @param args 
+ * 		(ex: 2 for "LC_ALL=C TZ=UTC sort file").
+ * 
+ * @return Function returns the number of assignments before the command name
+ *******************************************************************************************************************/
+size_t nano_env_assignments(char **args)
+{
+	size_t count = 0;
+
+	while (args[count] != NULL && nano_env_name_length(args[count]) > 0)
+	{
+		count++;
+	}
+
+	return count;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_env_export
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function sets the @param count assignments of @param assigns in the environment of nanoShell itself,
+ * 		used when a line only has assignments (ex: "LC_ALL=C"). The base environment cache is refreshed.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_env_export(char **assigns, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t length = nano_env_name_length(assigns[i]);
+
+		assigns[i][length] = 0;
+		if (setenv(assigns[i], &assigns[i][length + 1], 1) == -1)
+		{
+			WARNING("setenv %s", assigns[i]);
+		}
+		assigns[i][length] = '=';
+	}
+
+	nano_env_init();
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_env_overlay
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function builds the envp for EXECVPE of a command with @param count assignments in @param assigns.
+ * 		Without assignments the cached base environment is returned as is. Otherwise a new vector is made with
+ * 		the pointers of the base environment (the strings aren't copied), replacing the variables that are 
+ * 		assigned and appending the new ones.
+ * 		It is meant to be called in the child after fork, so nanoShell never copies its environment per command.
+ * 
+ * @return Function returns the envp vector terminated by NULL
+ *******************************************************************************************************************/
+char **nano_env_overlay(char **assigns, size_t count)
+{
+	char **envp;
+	size_t total = env_count;
+
+	if (count == 0)
+	{
+		return env_base;
+	}
+
+	envp = MALLOC((env_count + count + 1) * sizeof(char *));
+	if (envp == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+	}
+	memcpy(envp, env_base, env_count * sizeof(char *));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t length = nano_env_name_length(assigns[i]) + 1;
+		size_t j;
+
+		for (j = 0; j < total; j++)
+		{
+			if (strncmp(envp[j], assigns[i], length) == 0)
+			{
+				break;
+			}
+		}
+
+		envp[j] = assigns[i];
+		if (j == total)
+		{
+			total++;
+		}
+	}
+
+	envp[total] = NULL;
+	return envp;
+}
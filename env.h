@@ -0,0 +1,16 @@
+/**
+* @file env.h
+* @brief Environment overlays for commands started with NAME=value assignments
+*/
+
+#ifndef ENV_H
+#define ENV_H
+
+#include <stddef.h>
+
+void nano_env_init(void);
+size_t nano_env_assignments(char **args);
+void nano_env_export(char **assigns, size_t count);
+char **nano_env_overlay(char **assigns, size_t count);
+
+#endif /* ENV_H */
@@ -0,0 +1,127 @@
+/**
+* @file fuzz.c
+* @brief libFuzzer target of the parser (make fuzz): nano_verify_char, nano_split_lineptr and nano_verify_redirect
+* 		over arbitrary lines
+*
+* The input is cut at the first NUL or LINE FEED, as getline and nanoShell do, and goes through the same steps as a
+* line of nanoShell. A line rejected by nano_verify_char is still split, so the lexer is exercised with every
+* character. Run with: ./nanoShell-fuzz -max_len=65536 corpus/
+*
+* Without libFuzzer (NANO_FUZZ_MAIN defined) the program runs the target over the files given as arguments, to
+* replay a crash with any compiler.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "counters.h"
+#include "parse.h"
+#include "nanoShell.h"
+
+struct NanoCounters *counters; // Defined by main.c in nanoShell
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+
+/*******************************************************************************************************************
+ * Function LLVMFuzzerTestOneInput
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function parses the line in the @param size bytes of @param data as nanoShell does: verifies its
+ * 		characters, splits it in tokens and verifies the redirect of each command of the list.
+ *
+ * @return Function returns 0 (libFuzzer reserves the other values)
+ *******************************************************************************************************************/
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	char *lineptr = MALLOC(size + 1);
+	char **tokens;
+	size_t start = 0;
+
+	if (counters == NULL)
+	{
+		counters = nano_counters_open();
+	}
+
+	if (size > 0)
+	{
+		memcpy(lineptr, data, size);
+	}
+	lineptr[size] = 0;
+	lineptr[strcspn(lineptr, "\n")] = 0;
+
+	(void)nano_verify_char(lineptr);
+	tokens = nano_split_lineptr(lineptr);
+
+	/* Each command between the list operators, as nano_parse_list cuts them */
+	for (size_t i = 0;; i++)
+	{
+		if (tokens[i] == NULL || nano_list_operator(tokens[i]) != NULL)
+		{
+			char *next = tokens[i];
+			char *outputfile = NULL;
+
+			tokens[i] = NULL;
+			if (i > start)
+			{
+				(void)nano_verify_redirect(&tokens[start], &outputfile);
+			}
+			if (next == NULL)
+			{
+				break;
+			}
+			start = i + 1;
+		}
+	}
+
+	FREE(tokens);
+	FREE(lineptr);
+	return 0;
+}
+
+#ifdef NANO_FUZZ_MAIN
+/*******************************************************************************************************************
+ * Function main
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function runs the target over the files in @param argv, when it isn't linked with libFuzzer.
+ *
+ * @return Function returns 0, or 1 if a file can't be read
+ *******************************************************************************************************************/
+int main(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		FILE *fileptr = fopen(argv[i], "rb");
+		char *data = NULL;
+		size_t size = 0;
+		size_t n;
+		char buffer[4096];
+
+		if (fileptr == NULL)
+		{
+			printf("[ERROR] Error opening %s\n", argv[i]);
+			return 1;
+		}
+		while ((n = fread(buffer, 1, sizeof(buffer), fileptr)) > 0)
+		{
+			data = REALLOC(data, size + n);
+			memcpy(&data[size], buffer, n);
+			size += n;
+		}
+		fclose(fileptr);
+
+		LLVMFuzzerTestOneInput((const uint8_t *)data, size);
+		printf("%s: %zu bytes OK\n", argv[i], size);
+		if (data != NULL)
+		{
+			FREE(data);
+		}
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,192 @@
+/**
+* @file hdr.c
+* @brief HDR (high dynamic range) histogram of latencies
+*
+* Values below 2^sub_bits are counted exactly. Above, each power of two [2^k, 2^(k+1)) has 2^(sub_bits - 1) buckets,
+* so the relative error of any value is below 1 / 2^(sub_bits - 1) whatever its magnitude (ex: < 1.6% with 
+* sub_bits = 7, for nanoseconds up to centuries) in a fixed array of counters.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "hdr.h"
+
+
+/*******************************************************************************************************************
+ * Function nano_hdr_index
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function computes the index of the counter of @param value.
+ * 
+ * @return Function returns the index in @param hdr counts
+ *******************************************************************************************************************/
+static size_t nano_hdr_index(const struct NanoHdr *hdr, uint64_t value)
+{
+	uint64_t half = 1ULL << (hdr->sub_bits - 1);
+	int msb;
+	int shift;
+
+	if (value < (half << 1))
+	{
+		return (size_t)value;
+	}
+
+	msb = 63 - __builtin_clzll(value);
+	shift = msb - (hdr->sub_bits - 1);
+
+	return (size_t)((half << 1) + (uint64_t)(shift - 1) * half + ((value >> shift) - half));
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_hdr_value
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function computes the highest value counted by the counter @param index.
+ * 
+ * @return Function returns the highest value equivalent to @param index
+ *******************************************************************************************************************/
+static uint64_t nano_hdr_value(const struct NanoHdr *hdr, size_t index)
+{
+	uint64_t half = 1ULL << (hdr->sub_bits - 1);
+	uint64_t k;
+	int shift;
+
+	if (index < (half << 1))
+	{
+		return (uint64_t)index;
+	}
+
+	k = (uint64_t)index - (half << 1);
+	shift = (int)(k / half) + 1;
+
+	return (((k % half + half) + 1) << shift) - 1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_hdr_init
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function allocates the counters of @param hdr with @param sub_bits of precision (1 to 16).
+ * 
+ * @return Function returns 0 if OK and -1 if the memory couldn't be allocated
+ *******************************************************************************************************************/
+int nano_hdr_init(struct NanoHdr *hdr, int sub_bits)
+{
+	memset(hdr, 0, sizeof(*hdr));
+
+	hdr->sub_bits = sub_bits;
+	hdr->length = (1ULL << sub_bits) + (size_t)(64 - sub_bits) * (1ULL << (sub_bits - 1));
+	hdr->counts = MALLOC(hdr->length * sizeof(uint64_t));
+	hdr->min = UINT64_MAX;
+	if (hdr->counts == NULL)
+	{
+		return -1;
+	}
+	memset(hdr->counts, 0, hdr->length * sizeof(uint64_t));
+
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_hdr_record
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function counts @param value in @param hdr.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_hdr_record(struct NanoHdr *hdr, uint64_t value)
+{
+	hdr->counts[nano_hdr_index(hdr, value)]++;
+	hdr->total++;
+	hdr->sum += (double)value;
+
+	if (value < hdr->min)
+	{
+		hdr->min = value;
+	}
+	if (value > hdr->max)
+	{
+		hdr->max = value;
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_hdr_percentile
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function finds the value at @param percentile (0 to 100) of the values counted in @param hdr.
+ * 
+ * @return Function returns the value, at most the max recorded, or 0 if @param hdr is empty
+ *******************************************************************************************************************/
+uint64_t nano_hdr_percentile(const struct NanoHdr *hdr, double percentile)
+{
+	uint64_t target;
+	uint64_t seen = 0;
+
+	if (hdr->total == 0)
+	{
+		return 0;
+	}
+
+	target = (uint64_t)((percentile / 100.0) * (double)hdr->total + 0.5);
+	if (target < 1)
+	{
+		target = 1;
+	}
+
+	for (size_t i = 0; i < hdr->length; i++)
+	{
+		seen += hdr->counts[i];
+		if (seen >= target)
+		{
+			uint64_t value = nano_hdr_value(hdr, i);
+			return value < hdr->max ? value : hdr->max;
+		}
+	}
+	return hdr->max;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_hdr_print
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes to @param fileptr the min, mean, max and the usual percentiles of @param hdr, with the 
+ * 		values divided by @param unit and labelled with @param unit_name (ex: 1000.0 and "us" for nanoseconds).
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_hdr_print(FILE *fileptr, const struct NanoHdr *hdr, double unit, const char *unit_name)
+{
+	static const double percentiles[] = {50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 100.0};
+
+	if (hdr->total == 0)
+	{
+		fprintf(fileptr, "  no values\n");
+		return;
+	}
+
+	fprintf(fileptr, "  min %.1f %s, mean %.1f %s, max %.1f %s\n", (double)hdr->min / unit, unit_name,
+			hdr->sum / (double)hdr->total / unit, unit_name, (double)hdr->max / unit, unit_name);
+
+	for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+	{
+		fprintf(fileptr, "  %8.3f%% %12.1f %s\n", percentiles[i],
+				(double)nano_hdr_percentile(hdr, percentiles[i]) / unit, unit_name);
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_hdr_free
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function frees the counters of @param hdr.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_hdr_free(struct NanoHdr *hdr)
+{
+	FREE(hdr->counts);
+}
@@ -0,0 +1,29 @@
+/**
+* @file hdr.h
+* @brief HDR (high dynamic range) histogram of latencies
+*/
+
+#ifndef HDR_H
+#define HDR_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Log-linear histogram: every power of two is split in 2^(sub_bits - 1) linear sub-buckets */
+struct NanoHdr {
+	uint64_t *counts;
+	int sub_bits;
+	size_t length;
+	uint64_t total;
+	uint64_t min;
+	uint64_t max;
+	double sum;
+};
+
+int nano_hdr_init(struct NanoHdr *hdr, int sub_bits);
+void nano_hdr_record(struct NanoHdr *hdr, uint64_t value);
+uint64_t nano_hdr_percentile(const struct NanoHdr *hdr, double percentile);
+void nano_hdr_print(FILE *fileptr, const struct NanoHdr *hdr, double unit, const char *unit_name);
+void nano_hdr_free(struct NanoHdr *hdr);
+
+#endif /* HDR_H */
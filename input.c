@@ -0,0 +1,232 @@
+/**
+* @file input.c
+* @brief Here-documents (<<WORD) and here-strings (<<<) in sealed memfds
+*
+* The contents are written to an anonymous memory file (memfd_create), sealed read-only and given to the child as
+* stdin, so there are no temporary files nor cat processes. The lines of a here-document are read by the loop
+* that reads the commands (stdin or -f), right after the line that has it, and kept with the position of its <<
+* in the line. The command that has the << gets its own body, even when && or || skipped an earlier one.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "debug.h"
+#include "input.h"
+#include "nanoShell.h"
+
+#define NANO_HEREDOC_DELIMITERS " ;&|" // End of a token, as nano_split_lineptr cuts them
+#define NANO_HEREDOC_MAX 16 // Here-documents in one line
+#define NANO_HEREDOC_WORDSIZE 256
+
+/* Here-documents of the current line, by the position of their << in it */
+static const char *heredoc_line;
+static size_t heredoc_offset[NANO_HEREDOC_MAX];
+static char *heredoc_body[NANO_HEREDOC_MAX];
+static size_t heredoc_size[NANO_HEREDOC_MAX];
+static int heredoc_count;
+
+
+/*******************************************************************************************************************
+ * Function nano_input_memfd
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function creates a memory file with the @param size bytes of @param data, sealed so it can't be
+ * 		changed anymore, and rewinds it to be read from the start.
+ * 
+ * @return Function returns the file descriptor (close-on-exec) or -1 for an error
+ *******************************************************************************************************************/
+int nano_input_memfd(const char *data, size_t size)
+{
+	int fd = memfd_create("nanoShell-input", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+	if (fd == -1)
+	{
+		return -1;
+	}
+	for (size_t done = 0; done < size;)
+	{
+		ssize_t n = write(fd, data + done, size - done);
+
+		if (n == -1)
+		{
+			close(fd);
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1 ||
+		lseek(fd, 0, SEEK_SET) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_heredoc_find
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function looks in @param lineptr, from the position @param from, for the next token that starts a 
+ * 		here-document ("<<WORD" or "<<" with the word in the next token), and not a here-string. Its position 
+ * 		is saved in @param at and its delimiter word in @param word (empty if it is missing).
+ * 
+ * @return Function returns 1 if a here-document was found and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_heredoc_find(const char *lineptr, size_t from, size_t *at, char word[NANO_HEREDOC_WORDSIZE])
+{
+	for (size_t i = from; lineptr[i] != 0; i++)
+	{
+		const char *next;
+
+		if (strncmp(&lineptr[i], "<<", 2) != 0 || lineptr[i + 2] == '<' || 
+			(i > 0 && strchr(NANO_HEREDOC_DELIMITERS, lineptr[i - 1]) == NULL))
+		{
+			continue;
+		}
+
+		next = &lineptr[i + 2];
+		next += next[0] == ' ' ? strspn(next, " ") : 0;
+		snprintf(word, NANO_HEREDOC_WORDSIZE, "%.*s", (int)strcspn(next, NANO_HEREDOC_DELIMITERS), next);
+		*at = i;
+		return 1;
+	}
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_heredoc_count
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function counts the here-documents of the line @param lineptr.
+ * 
+ * @return Function returns the number of here-documents
+ *******************************************************************************************************************/
+int nano_heredoc_count(const char *lineptr)
+{
+	char word[NANO_HEREDOC_WORDSIZE];
+	size_t at = 0;
+	int count = 0;
+
+	for (size_t from = 0; nano_heredoc_find(lineptr, from, &at, word); from = at + 2)
+	{
+		count++;
+	}
+	return count;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_heredoc_collect
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads from @param fileptr the lines of each here-document of the line @param lineptr, until
+ * 		the line with only its delimiter, and keeps them for nano_heredoc_open. @param prompt is printed 
+ * 		before each line (NULL for none).
+ * 
+ * @return Function returns the number of lines read from @param fileptr, or -1 for a missing delimiter or
+ * 		the end of @param fileptr before it (the error is printed)
+ *******************************************************************************************************************/
+int nano_heredoc_collect(const char *lineptr, FILE *fileptr, const char *prompt)
+{
+	char *body_line = NULL;
+	size_t n = 0;
+	char delimiter[NANO_HEREDOC_WORDSIZE];
+	size_t at = 0;
+	int lines = 0;
+	int res = 0;
+
+	nano_heredoc_clear();
+	heredoc_line = lineptr;
+
+	for (size_t from = 0; res == 0 && nano_heredoc_find(lineptr, from, &at, delimiter); from = at + 2)
+	{
+		FILE *body;
+		ssize_t length;
+
+		if (delimiter[0] == 0 || heredoc_count == NANO_HEREDOC_MAX)
+		{
+			printf("[ERROR] Wrong here-document: missing word after << (or more than %d)\n", NANO_HEREDOC_MAX);
+			res = -1;
+			break;
+		}
+
+		body = open_memstream(&heredoc_body[heredoc_count], &heredoc_size[heredoc_count]);
+		if (body == NULL)
+		{
+			ERROR(NANO_ERROR_MALLOC, "Error allocating the here-document\n");
+		}
+		for (;;)
+		{
+			if (prompt != NULL)
+			{
+				printf("%s", prompt);
+			}
+			if ((length = getline(&body_line, &n, fileptr)) == -1)
+			{
+				printf("[ERROR] Here-document ended before '%s'\n", delimiter);
+				res = -1;
+				break;
+			}
+			lines++;
+			if (strcspn(body_line, "\n") == strlen(delimiter) && strncmp(body_line, delimiter, strlen(delimiter)) == 0)
+			{
+				break;
+			}
+			fwrite(body_line, 1, (size_t)length, body);
+		}
+		fclose(body);
+		heredoc_offset[heredoc_count] = at;
+		heredoc_count++;
+	}
+
+	free(body_line);
+	return res == 0 ? lines : -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_heredoc_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function gives the here-document of the token @param token ("<<WORD" or "<<") as a sealed memory file.
+ * 		The token must be in the line given to nano_heredoc_collect, split in place (nano_split_lineptr), so
+ * 		its position in the line tells which here-document it is.
+ * 
+ * @return Function returns the file descriptor, or -1 if there isn't one or it can't be created
+ *******************************************************************************************************************/
+int nano_heredoc_open(const char *token)
+{
+	for (int i = 0; heredoc_line != NULL && i < heredoc_count; i++)
+	{
+		if (token == heredoc_line + heredoc_offset[i])
+		{
+			return nano_input_memfd(heredoc_body[i], heredoc_size[i]);
+		}
+	}
+	return -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_heredoc_clear
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function frees the here-documents of the current line.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_heredoc_clear(void)
+{
+	for (int i = 0; i < heredoc_count; i++)
+	{
+		free(heredoc_body[i]);
+		heredoc_body[i] = NULL;
+	}
+	heredoc_count = 0;
+	heredoc_line = NULL;
+}
@@ -0,0 +1,18 @@
+/**
+* @file input.h
+* @brief Here-documents (<<WORD) and here-strings (<<<) in sealed memfds
+*/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+int nano_input_memfd(const char *data, size_t size);
+int nano_heredoc_count(const char *lineptr);
+int nano_heredoc_collect(const char *lineptr, FILE *fileptr, const char *prompt);
+int nano_heredoc_open(const char *token);
+void nano_heredoc_clear(void);
+
+#endif /* INPUT_H */
@@ -0,0 +1,253 @@
+/**
+* @file journal.c
+* @brief Checkpoint journal of the lines completed by -f, to resume an interrupted run (--journal, --resume)
+*
+* The journal is a text file: a header "NSHJRN1 {hash of the script}" and a line "{line number} {exit status}"
+* for each command line of the script that completed. The records are appended as they complete, but the 
+* fdatasync is batched (every NANO_JOURNAL_SYNC_RECORDS records or NANO_JOURNAL_SYNC_NS), so a crash can lose 
+* the last records and those lines are executed again by --resume.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "journal.h"
+#include "nanoShell.h"
+
+#define NANO_JOURNAL_MAGIC "NSHJRN1"
+#define NANO_JOURNAL_BUFSIZE 65536
+#define NANO_JOURNAL_SYNC_RECORDS 64
+#define NANO_JOURNAL_SYNC_NS 1000000000ULL
+
+int nano_journal_enabled = 0;
+
+static int journal_fd = -1;
+static pid_t journal_pid; // Children inherit the atexit handler
+static unsigned int journal_unsynced;
+static uint64_t journal_synced_at;
+
+/* Bitmap of the lines completed with exit status 0 in the resumed run */
+static unsigned char *journal_done;
+static unsigned int journal_done_lines;
+
+
+/*******************************************************************************************************************
+ * Function nano_journal_hash
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function computes the hash of the contents of the file @param path in @param hash.
+ * 
+ * @return Function returns 0 if OK and -1 if the file can't be read
+ *******************************************************************************************************************/
+static int nano_journal_hash(const char *path, uint64_t *hash)
+{
+	static unsigned char buffer[NANO_JOURNAL_BUFSIZE];
+	ssize_t length;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd == -1)
+	{
+		return -1;
+	}
+	*hash = NANO_FNV_OFFSET;
+	while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+	{
+		*hash = nano_fnv1a(*hash, buffer, (size_t)length);
+	}
+	close(fd);
+	return length == -1 ? -1 : 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_journal_load
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the journal open in @param fileptr, written for the script with hash @param hash, and 
+ * 		marks its lines with exit status 0 as done. The offset after the last complete record is saved in 
+ * 		@param end, so a record cut by a crash can be dropped.
+ * 
+ * @return Function returns 0 if OK, NANO_JOURNAL_ERROR_SCRIPT if the journal is of another script and 
+ * 		NANO_JOURNAL_ERROR_IO if it can't be read
+ *******************************************************************************************************************/
+static int nano_journal_load(FILE *fileptr, uint64_t hash, off_t *end)
+{
+	unsigned long long journal_hash;
+	unsigned int line;
+	int exit_status;
+	char newline;
+
+	if (fscanf(fileptr, NANO_JOURNAL_MAGIC " %16llx%c", &journal_hash, &newline) != 2 || newline != '\n')
+	{
+		return NANO_JOURNAL_ERROR_IO;
+	}
+	if (journal_hash != hash)
+	{
+		return NANO_JOURNAL_ERROR_SCRIPT;
+	}
+
+	*end = ftello(fileptr);
+	while (fscanf(fileptr, "%u %d%c", &line, &exit_status, &newline) == 3 && newline == '\n')
+	{
+		*end = ftello(fileptr);
+		if (exit_status != 0)
+		{
+			continue;
+		}
+		if (line >= journal_done_lines)
+		{
+			unsigned int lines = (line / 8 + 1) * 16;
+			unsigned char *done = REALLOC(journal_done, lines / 8);
+
+			if (done == NULL)
+			{
+				return NANO_JOURNAL_ERROR_IO;
+			}
+			memset(done + journal_done_lines / 8, 0, (lines - journal_done_lines) / 8);
+			journal_done = done;
+			journal_done_lines = lines;
+		}
+		journal_done[line / 8] |= (unsigned char)(1 << (line % 8));
+	}
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_journal_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function opens the journal @param path of the script @param script. With @param resume the records of
+ * 		the journal are loaded, if it exists, and the new ones are appended. Otherwise it starts empty.
+ * 
+ * @return Function returns 0 if OK, NANO_JOURNAL_ERROR_SCRIPT if the journal is of a different version of the 
+ * 		script and NANO_JOURNAL_ERROR_IO for an error reading or writing
+ *******************************************************************************************************************/
+int nano_journal_open(const char *path, const char *script, int resume)
+{
+	char header[64];
+	uint64_t hash;
+	FILE *fileptr;
+	int length;
+
+	if (nano_journal_hash(script, &hash) == -1)
+	{
+		return NANO_JOURNAL_ERROR_IO;
+	}
+
+	if (resume && (fileptr = fopen(path, "r")) != NULL)
+	{
+		off_t end = 0;
+		int res = nano_journal_load(fileptr, hash, &end);
+
+		fclose(fileptr);
+		if (res != 0)
+		{
+			return res;
+		}
+		if ((journal_fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC)) == -1 || ftruncate(journal_fd, end) == -1)
+		{
+			return NANO_JOURNAL_ERROR_IO;
+		}
+	}
+	else
+	{
+		if ((journal_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666)) == -1)
+		{
+			return NANO_JOURNAL_ERROR_IO;
+		}
+		length = snprintf(header, sizeof(header), NANO_JOURNAL_MAGIC " %016llx\n", (unsigned long long)hash);
+		if (write(journal_fd, header, (size_t)length) != length || fdatasync(journal_fd) == -1)
+		{
+			return NANO_JOURNAL_ERROR_IO;
+		}
+	}
+
+	journal_pid = getpid();
+	journal_synced_at = nano_time_ns();
+	nano_journal_enabled = 1;
+	atexit(nano_journal_close);
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_journal_done
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies if the line @param line of the script completed with exit status 0 in the resumed 
+ * 		run, so it can be skipped.
+ * 
+ * @return Function returns 1 if the line is done and 0 otherwise
+ *******************************************************************************************************************/
+int nano_journal_done(unsigned int line)
+{
+	return line < journal_done_lines && (journal_done[line / 8] & (1 << (line % 8))) != 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_journal_record
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function appends to the journal that the line @param line of the script completed with 
+ * 		@param exit_status. The journal is synced to the disk after NANO_JOURNAL_SYNC_RECORDS records or 
+ * 		NANO_JOURNAL_SYNC_NS since the last sync.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_journal_record(unsigned int line, int exit_status)
+{
+	char record[32];
+	int length;
+	uint64_t now;
+
+	if (!nano_journal_enabled)
+	{
+		return;
+	}
+
+	length = snprintf(record, sizeof(record), "%u %d\n", line, exit_status);
+	if (write(journal_fd, record, (size_t)length) != length)
+	{
+		WARNING("Error writing the journal record of line %u", line);
+	}
+
+	now = nano_time_ns();
+	if (++journal_unsynced >= NANO_JOURNAL_SYNC_RECORDS || now - journal_synced_at >= NANO_JOURNAL_SYNC_NS)
+	{
+		if (fdatasync(journal_fd) == -1)
+		{
+			WARNING("Error syncing the journal");
+		}
+		journal_unsynced = 0;
+		journal_synced_at = now;
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_journal_close
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function syncs the records not synced yet and closes the journal. Called at exit.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_journal_close(void)
+{
+	if (!nano_journal_enabled || getpid() != journal_pid)
+	{
+		return;
+	}
+	nano_journal_enabled = 0;
+
+	if (journal_unsynced > 0 && fdatasync(journal_fd) == -1)
+	{
+		WARNING("Error syncing the journal");
+	}
+	close(journal_fd);
+	FREE(journal_done);
+}
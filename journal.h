@@ -0,0 +1,20 @@
+/**
+* @file journal.h
+* @brief Checkpoint journal of the lines completed by -f, to resume an interrupted run (--journal, --resume)
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/* Errors of nano_journal_open */
+#define NANO_JOURNAL_ERROR_IO -1
+#define NANO_JOURNAL_ERROR_SCRIPT -2
+
+extern int nano_journal_enabled;
+
+int nano_journal_open(const char *path, const char *script, int resume);
+int nano_journal_done(unsigned int line);
+void nano_journal_record(unsigned int line, int exit_status);
+void nano_journal_close(void);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,169 @@
+/**
+* @file loadgen.c
+* @brief Load generator mode (--repeat N [--rate R/s] -- command)
+*
+* The command is executed through the normal nano_exec_commands path, so the measured latency is the one of
+* nanoShell itself (validate, split, fork, exec and wait) without any wrapper around it.
+*
+* Without --rate the loop is closed: each execution starts when the previous one ends and its latency is its own
+* duration. With --rate the executions are scheduled at fixed intervals (open-loop) and the latency is measured
+* from the scheduled start, so a slow execution that delays the next ones is accounted for in all of them instead 
+* of being hidden (coordinated omission).
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "hdr.h"
+#include "loadgen.h"
+#include "nanoShell.h"
+
+#define NANO_HDR_SUB_BITS 7 // Latencies with less than 1.6% of error
+
+
+/*******************************************************************************************************************
+ * Function nano_parse_rate
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function parses the rate @param str, as a number of events per second ("100" or "100/s"), per minute 
+ * 		("100/m") or per hour ("100/h") and saves it in events per second in @param per_second.
+ * 
+ * @return Function returns 0 if OK and -1 if @param str isn't a valid rate between NANO_RATE_MIN and 
+ * 		NANO_RATE_MAX per second
+ *******************************************************************************************************************/
+int nano_parse_rate(const char *str, double *per_second)
+{
+	char *end;
+	double value = strtod(str, &end);
+
+	if (end == str || value <= 0)
+	{
+		return -1;
+	}
+
+	if (*end == 0 || strcmp(end, "/s") == 0)
+	{
+		*per_second = value;
+	}
+	else if (strcmp(end, "/m") == 0)
+	{
+		*per_second = value / 60.0;
+	}
+	else if (strcmp(end, "/h") == 0)
+	{
+		*per_second = value / 3600.0;
+	}
+	else
+	{
+		return -1;
+	}
+	/* Negated so NaN is rejected too */
+	if (!(*per_second >= NANO_RATE_MIN && *per_second <= NANO_RATE_MAX))
+	{
+		return -1;
+	}
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_loadgen
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function joins the @param inputs_num words of @param inputs in a command line and executes it 
+ * 		@param repeat times with @param exec. With @param rate > 0 the executions are scheduled at 1 / @param rate
+ * 		seconds from each other (open-loop), otherwise they are executed one after the other (closed-loop).
+ * 		At the end the latency percentiles, the throughput and the number of executions with an exit 
+ * 		status != 0 are printed.
+ * 
+ * @return Function returns the number of executions that failed
+ *******************************************************************************************************************/
+int nano_loadgen(char **inputs, unsigned int inputs_num, unsigned int repeat, double rate,
+				 int (*exec)(char *lineptr))
+{
+	struct NanoHdr hdr;
+	size_t length = 0;
+	char *line;
+	char *work;
+	unsigned int errors = 0;
+	uint64_t interval = rate > 0 ? (uint64_t)(1e9 / rate) : 0;
+	uint64_t start;
+	uint64_t late = 0;
+
+	for (unsigned int i = 0; i < inputs_num; i++)
+	{
+		length += strlen(inputs[i]) + 1;
+	}
+
+	line = MALLOC(length + 1);
+	work = MALLOC(length + 1);
+	if (line == NULL || work == NULL || nano_hdr_init(&hdr, NANO_HDR_SUB_BITS) == -1)
+	{
+		ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+	}
+
+	line[0] = 0;
+	for (unsigned int i = 0; i < inputs_num; i++)
+	{
+		if (i > 0)
+		{
+			strcat(line, " ");
+		}
+		strcat(line, inputs[i]);
+	}
+
+	printf("[INFO] Executing '%s' %u times, %s\n", line, repeat, interval > 0 ? "open-loop" : "closed-loop");
+	fflush(stdout);
+
+	start = nano_time_ns();
+	for (unsigned int i = 0; i < repeat; i++)
+	{
+		uint64_t scheduled = start + (uint64_t)i * interval;
+		uint64_t begin;
+
+		if (interval > 0)
+		{
+			struct timespec ts = {(time_t)(scheduled / 1000000000ULL), (long)(scheduled % 1000000000ULL)};
+
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+				;
+		}
+
+		/* nano_exec_commands splits the line in place */
+		memcpy(work, line, length + 1);
+
+		begin = nano_time_ns();
+		if (interval > 0 && begin > scheduled + interval)
+		{
+			late++;
+		}
+
+		if (exec(work) != 0)
+		{
+			errors++;
+		}
+
+		nano_hdr_record(&hdr, nano_time_ns() - (interval > 0 ? scheduled : begin));
+	}
+
+	double elapsed = (double)(nano_time_ns() - start) / 1e9;
+
+	printf("\n[INFO] %u execution(s) in %.3f s: %.1f executions/sec", repeat, elapsed,
+		   elapsed > 0 ? repeat / elapsed : 0.0);
+	if (interval > 0)
+	{
+		printf(" (target %.1f/sec, %lu started late)", rate, (unsigned long)late);
+	}
+	printf(", %u error(s)\n[INFO] Latency:\n", errors);
+	nano_hdr_print(stdout, &hdr, 1000.0, "us");
+
+	nano_hdr_free(&hdr);
+	FREE(work);
+	FREE(line);
+
+	return (int)errors;
+}
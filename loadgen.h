@@ -0,0 +1,17 @@
+/**
+* @file loadgen.h
+* @brief Load generator mode (--repeat N [--rate R/s] -- command)
+*/
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+/* Limits of a rate, so the interval between events is at least 1 ns and fits in an uint64_t of ns */
+#define NANO_RATE_MAX 1e9
+#define NANO_RATE_MIN 1e-9
+
+int nano_parse_rate(const char *str, double *per_second);
+int nano_loadgen(char **inputs, unsigned int inputs_num, unsigned int repeat, double rate,
+				 int (*exec)(char *lineptr));
+
+#endif /* LOADGEN_H */
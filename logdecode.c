@@ -0,0 +1,227 @@
+/**
+* @file logdecode.c
+* @brief nanoShell-logdecode: converts the binary log dumps of nanoShell (nano_log_dump) to text
+*
+* Usage: nanoShell-logdecode nanoShell_log_<date>.bin
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "debug.h"
+#include "nanoShell.h"
+
+#define NANO_LOG_SITES 65536
+
+struct NanoDecodeSite {
+	char *file;
+	char *fmt;
+	int line;
+};
+
+static const char *level_names[] = {"ERROR", "WARNING", "DEBUG"};
+
+
+/*******************************************************************************************************************
+ * Function nano_decode_read
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads exactly @param size bytes of @param fileptr to @param buf.
+ * 
+ * @return Function returns 0 if OK and -1 if the file ended before
+ *******************************************************************************************************************/
+static int nano_decode_read(FILE *fileptr, void *buf, size_t size)
+{
+	return fread(buf, 1, size, fileptr) == size ? 0 : -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_decode_record
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function prints the text of @param rec, formatting its arguments with the format of @param site.
+ * 		WARNING and ERROR messages end with the system error message, as printed by debug.c.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_decode_record(const struct NanoLogRecord *rec, const struct NanoDecodeSite *site)
+{
+	struct NanoLogSpec specs[NANO_LOG_MAXARGS];
+	char timebuf[64];
+	char spec[64];
+	time_t seconds = (time_t)(rec->time / 1000000000ULL);
+	struct tm *tm = localtime(&seconds);
+	int nspecs;
+	size_t pos = 0;
+	size_t copied = 0;
+
+	strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", tm);
+	printf("%s.%06lu %s [%s@%d] ", timebuf, (unsigned long)(rec->time % 1000000000ULL / 1000),
+		   rec->level <= NANO_LOG_DEBUG ? level_names[rec->level] : "?", site->file, site->line);
+
+	nspecs = nano_log_parse_format(site->fmt, specs, NANO_LOG_MAXARGS);
+	for (int i = 0; i < nspecs; i++)
+	{
+		size_t length = specs[i].end - specs[i].start;
+		int64_t integer;
+		double real;
+
+		fwrite(&site->fmt[copied], 1, specs[i].start - copied, stdout);
+		copied = specs[i].end;
+
+		if (i >= rec->nargs || length >= sizeof(spec))
+		{
+			printf("<?>");
+			continue;
+		}
+		memcpy(spec, &site->fmt[specs[i].start], length);
+		spec[length] = 0;
+
+		if (specs[i].type == 's')
+		{
+			size_t len = rec->args[pos];
+			char str[256];
+
+			memcpy(str, &rec->args[pos + 1], len);
+			str[len] = 0;
+			printf(spec, str);
+			pos += len + 1;
+			continue;
+		}
+
+		memcpy(&integer, &rec->args[pos], 8);
+		pos += 8;
+
+		switch (specs[i].type)
+		{
+		case 'd':
+			memcpy(&real, &integer, sizeof(real));
+			printf(spec, real);
+			break;
+		case 'l':
+			printf(spec, (long)integer);
+			break;
+		case 'L':
+			printf(spec, (long long)integer);
+			break;
+		case 'z':
+			printf(spec, (size_t)integer);
+			break;
+		case 'j':
+			printf(spec, (intmax_t)integer);
+			break;
+		case 't':
+			printf(spec, (ptrdiff_t)integer);
+			break;
+		case 'p':
+			printf(spec, (void *)(uintptr_t)integer);
+			break;
+		default:
+			printf(spec, (int)integer);
+			break;
+		}
+	}
+	printf("%s", &site->fmt[copied]);
+
+	if (rec->level != NANO_LOG_DEBUG)
+	{
+		printf(": %s", strerror(rec->err));
+	}
+	printf("\n");
+}
+
+
+/*******************************************************************************************************************
+ * Function main
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the format table of the dump given in argv[1] and prints every record as text.
+ * 
+ * @return Function returns 0 if OK and 1 if the file isn't a valid dump
+ *******************************************************************************************************************/
+int main(int argc, char *argv[])
+{
+	FILE *fileptr;
+	char magic[8];
+	uint32_t nsites;
+	uint32_t size;
+	uint64_t count;
+	struct NanoDecodeSite *sites;
+	struct NanoLogRecord rec;
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s <nanoShell log dump>\n", argv[0]);
+		return 1;
+	}
+
+	fileptr = fopen(argv[1], "r");
+	if (fileptr == NULL)
+	{
+		ERROR(NANO_ERROR_IO, "Error opening %s for reading!\n", argv[1]);
+	}
+
+	if (nano_decode_read(fileptr, magic, 8) == -1 || memcmp(magic, NANO_LOG_MAGIC, 8) != 0 ||
+		nano_decode_read(fileptr, &nsites, 4) == -1 || nano_decode_read(fileptr, &size, 4) == -1 ||
+		nano_decode_read(fileptr, &count, 8) == -1 || size != sizeof(rec))
+	{
+		fprintf(stderr, "[ERROR] %s isn't a nanoShell log dump\n", argv[1]);
+		return 1;
+	}
+
+	sites = calloc(NANO_LOG_SITES, sizeof(struct NanoDecodeSite));
+	if (sites == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+	}
+
+	for (uint32_t i = 0; i < nsites; i++)
+	{
+		uint16_t head[4];
+		int32_t line;
+
+		if (nano_decode_read(fileptr, head, sizeof(head)) == -1 || nano_decode_read(fileptr, &line, 4) == -1)
+		{
+			fprintf(stderr, "[ERROR] %s is truncated\n", argv[1]);
+			return 1;
+		}
+
+		sites[head[0]].file = calloc(head[1] + 1, 1);
+		sites[head[0]].fmt = calloc(head[2] + 1, 1);
+		sites[head[0]].line = line;
+		if (sites[head[0]].file == NULL || sites[head[0]].fmt == NULL)
+		{
+			ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+		}
+		if (nano_decode_read(fileptr, sites[head[0]].file, head[1]) == -1 ||
+			nano_decode_read(fileptr, sites[head[0]].fmt, head[2]) == -1)
+		{
+			fprintf(stderr, "[ERROR] %s is truncated\n", argv[1]);
+			return 1;
+		}
+	}
+
+	for (uint64_t n = 0; n < count && nano_decode_read(fileptr, &rec, sizeof(rec)) == 0; n++)
+	{
+		if (sites[rec.site].fmt == NULL)
+		{
+			printf("[unknown format %u]\n", rec.site);
+			continue;
+		}
+		nano_decode_record(&rec, &sites[rec.site]);
+	}
+
+	for (size_t i = 0; i < NANO_LOG_SITES; i++)
+	{
+		free(sites[i].file);
+		free(sites[i].fmt);
+	}
+	free(sites);
+	fclose(fileptr);
+
+	return 0;
+}
@@ -15,52 +15,84 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 
 #include "debug.h"
 #include "memory.h"
 #include "args.h"
+#include "env.h"
+#include "nanoShell.h"
+#include "trace.h"
+#include "probes.h"
+#include "record.h"
+#include "loadgen.h"
+#include "ratelimit.h"
+#include "dag.h"
+#include "memo.h"
+#include "journal.h"
+#include "affinity.h"
+#include "priority.h"
+#include "compress.h"
+#include "input.h"
+#include "stats.h"
+#include "metrics.h"
+#include "counters.h"
+#include "watch.h"
+#include "capture.h"
+#include "xargs.h"
+#include "parse.h"
 #include "time.h"
 
 /**
  * DEFINITIONS
  */
-#define NANO_TOKENS_BUFSIZE 32 //Size for tokes buffer
 #define NANO_TIME_BUFSIZE 256  //Size for time buffer
-#define C_EXIT_FAILURE -1
-#define C_EXIT_SUCCESS 0
-#define C_ERROR_PARSING_ARGS 1
-#define NANO_TIME_ERROR 2
-#define NANO_ERROR_MALLOC 3
-#define NANO_ERROR_READ 4
-#define NANO_ERROR_IO 5
-#define NANO_ERROR_FORK 6
-#define NANO_ERROR_EXECVP 7
-#define NANO_ERROR_SIGACTION 8
-#define NANO_MAX_INVALID 9
+#define NANO_BATCH_BUFSIZE 65536 //Size for stdin and stdout buffers in batch mode
+
+/* Connectors of a command list, stored in the node that follows them */
+#define NANO_OP_SEQ 0 // ';' (and the first command of the list)
+#define NANO_OP_AND 1 // '&&'
+#define NANO_OP_OR 2  // '||'
 
 // DEFINE GLOBAL VARIABLES
 int status = 0; // Status for terminating nanoShell
 struct tm *ptm;
 struct tm *current;
+uint64_t probe_line_start; // Start of the validation of the current line, for the command_parsed probe
+int batch = 0;			   // Non-interactive: no prompt nor [INFO] messages of the redirects
+int tail_call = 0;		   // The line executed is the last one: its last command replaces nanoShell
+
+struct NanoCounters *counters;
+
+/* One command of a list: a NULL terminated slice of the tokens array */
+struct NanoNode {
+	char **args;
+	int op;
+};
 
-struct NanoCounters {
-	unsigned int G_count_stdout;
-	unsigned int G_count_stderr;
-	unsigned int G_max_commands;
-	unsigned int G_count_commands;
-} counters;
+/* Flat list of commands joined by ;, && and ||, evaluated left to right */
+struct NanoList {
+	struct NanoNode *nodes;
+	size_t count;
+	size_t capacity;
+};
 
 
 // FUNCTIONS DECLARATION
 void nano_sig_handler(int sig, siginfo_t *siginfo, void *context);
-int nano_verify_redirect(char **args, char **outputfile);
+int nano_verify_input(char **args);
 void nano_verify_terminate(char **args);
-int nano_verify_char(char *lineptr);
-void nano_verify_pointer(char **ptr);
-char **nano_split_lineptr(char *lineptr);
+int nano_parse_list(char **tokens, struct NanoList *list);
+ssize_t nano_list_next(const struct NanoList *list, size_t from, int exit_status);
+int nano_exit_status(int wstatus);
 char *nano_read_command(char *line);
-void nano_exec_commands(char *lineptr);
+int nano_exec_simple(char **args, int tail);
+int nano_tail_call_possible(int result);
+int nano_exec_commands(char *lineptr);
 void nano_loop(void);
+int nano_exec_file(FILE *fileptr, unsigned int jobs);
+int nano_file_last(FILE *fileptr);
 
 
 /*******************************************************************************************************************
@@ -77,8 +109,16 @@ void nano_loop(void);
  * 														- number of executed commands redirected to stdout
  * 														- number of executed commands redirected to stderr
  * 
+ * 								writes the allocation statistics (only with --memstats) to 
+ * 								"nanoShell_memory_currentDate_currentHour.txt"
+ * 								and dumps the binary log to "nanoShell_log_currentDate_currentHour.bin"
+ * 								(converted to text with nanoShell-logdecode)
+ * 
  * 					-SIGINT - Terminates the nanoShell printing the PID process that have sent the signal
  * 
+ * 					-SIGRTMIN - Changes the log level: to the value sent with sigqueue, or to the next one
+ * 								(ERROR -> WARNING -> DEBUG -> ERROR) with kill
+ * 
  *******************************************************************************************************************/
 void nano_sig_handler(int sig, siginfo_t *siginfo, void *context)
 {
@@ -88,6 +128,8 @@ void nano_sig_handler(int sig, siginfo_t *siginfo, void *context)
 	/* Copy from global variable errno */
 	aux = errno;
 
+	NANO_PROBE2(signal_received, (int)siginfo->si_pid, sig);
+
 	if (sig == SIGUSR1)
 	{
 
@@ -130,10 +172,43 @@ void nano_sig_handler(int sig, siginfo_t *siginfo, void *context)
 		}
 
 		fprintf(fileptr, "%u execution(s) of applications\n%u execution(s) with STDOUT redir\n%u execution(s) with STDERR redir\n",
-				counters.G_count_commands, counters.G_count_stdout, counters.G_count_stderr);
+				counters->G_count_commands, counters->G_count_stdout, counters->G_count_stderr);
+		if (nano_memo_enabled)
+		{
+			fprintf(fileptr, "%u memo hit(s)\n%u memo miss(es)\n", counters->G_count_memo_hits,
+					counters->G_count_memo_misses);
+		}
+		nano_ratelimit_status(fileptr);
+		nano_stats_print(fileptr, 0);
 
 		fclose(fileptr);
 
+		/* Only with --memstats */
+		if (eipa_mem_accounting_enabled())
+		{
+			strftime(bufer, NANO_TIME_BUFSIZE, "nanoShell_memory_%d.%m.%Y_%Hh:%M.%S.txt", current);
+			fileptr = fopen(bufer, "w");
+			if (fileptr == NULL)
+			{
+				WARNING("Error opening %s for writing", bufer);
+			}
+			else
+			{
+				eipa_mem_dump(fileptr);
+				fclose(fileptr);
+			}
+		}
+
+		strftime(bufer, NANO_TIME_BUFSIZE, "nanoShell_log_%d.%m.%Y_%Hh:%M.%S.bin", current);
+		if (nano_log_dump(bufer) == -1)
+		{
+			WARNING("Error writing log dump %s", bufer);
+		}
+
+	}
+	else if (sig == SIGRTMIN)
+	{
+		nano_log_signal(siginfo);
 	}
 	else if (sig == SIGINT)
 	{
@@ -149,83 +224,78 @@ void nano_sig_handler(int sig, siginfo_t *siginfo, void *context)
 
 
 /*******************************************************************************************************************
- * Function nano_verify_redirect
- * ----------------------------------------------------------------------------------------------------------------
- * @brief Function receives @param args with the inserted command and verifies
- * 	if the command is a redirect command, saving the redirect destination to
- * 	@param outputfile. Then counters for the total executed commands, stdout 
- * redirect commands and stderr redirect commands are also incremented here.
- * 
- * @return Function returns an Int depending on the redirect:
- * 
- * 				-1 if it isn't a redirect command
- * 				 1 if it is a stdout redirect to new or clean file
- * 				 2 if it is a stdout redirect to append in file
- * 				 3 if it is a stderr redirect to new or clean file
- * 				 4 if it is a stderr redirect to append in file
+ * Function nano_verify_input
+ * ---------------------------------------------------------------------------------------------------------------
+ * @brief Function receives @param args with the inserted command and verifies if it has an input redirect:
+ * 		< FILE, a here-document (<<WORD or << WORD, whose lines were read with the command line) or a 
+ * 		here-string (<<< WORD). The redirect is removed from @param args and its input is opened: the file, or
+ * 		a sealed memfd with the here-document or the WORD and a LINE FEED. If there is more than one, the 
+ * 		last one is the stdin of the command.
  * 
+ * @return Function returns the file descriptor for the stdin of the command, -1 if there isn't an input 
+ * 		redirect and -2 for an error (the error is printed)
  *******************************************************************************************************************/
-int nano_verify_redirect(char **args, char **outputfile)
+int nano_verify_input(char **args)
 {
+	int fd = -1;
+	int i = 0;
 
-	for (int i = 0; args[i] != NULL; i++)
+	while (args[i] != NULL)
 	{
-		if ((strcmp(args[i], ">") == 0))
-		{
-			*outputfile = args[i + 1];
-
-			args[i] = NULL;
+		/* The operator is followed by its word in the same token (<file) or in the next one (< file) */
+		size_t op = strspn(args[i], "<");
+		char *word = args[i][op] != 0 ? &args[i][op] : args[i + 1];
+		int tokens = args[i][op] != 0 ? 1 : 2;
+		int new_fd = -1;
 
-			//Increment STDOUT redir counter
-			counters.G_count_stdout++;
-			//Increment Total commands executed
-			counters.G_count_commands++;
+		if (op == 0)
+		{
+			i++;
+			continue;
+		}
 
-			return 1;
+		if (op > 3 || word == NULL)
+		{
+			printf("[ERROR] Wrong input redirect: %s\n", args[i]);
 		}
-		if ((strcmp(args[i], ">>") == 0))
+		else if (op == 1 && (new_fd = open(word, O_RDONLY | O_CLOEXEC)) == -1)
 		{
-			*outputfile = args[i + 1];
-
-			args[i] = NULL;
-
-			//Increment STDOUT redir counter
-			counters.G_count_stdout++;
-			//Increment Total commands executed
-			counters.G_count_commands++;
-
-			return 2;
+			printf("[ERROR] Error opening %s for reading\n", word);
 		}
-		if ((strcmp(args[i], "2>") == 0))
+		else if (op == 2 && (new_fd = nano_heredoc_open(args[i])) == -1)
 		{
-			*outputfile = args[i + 1];
-
-			args[i] = NULL;
-
-			//Increment STDERR redir counter
-			counters.G_count_stderr++;
-			//Increment Total commands executed
-			counters.G_count_commands++;
-
-			return 3;
+			printf("[ERROR] Missing here-document for <<%s\n", word);
 		}
-		if ((strcmp(args[i], "2>>") == 0))
+		else if (op == 3)
 		{
+			size_t length = strlen(word);
 
-			*outputfile = args[i + 1];
-
-			args[i] = NULL;
+			/* The LINE FEED is added in place of the terminator, and put back after */
+			word[length] = '\n';
+			new_fd = nano_input_memfd(word, length + 1);
+			word[length] = 0;
+		}
 
-			//Increment STDERR redir counter
-			counters.G_count_stderr++;
-			//Increment Total commands executed
-			counters.G_count_commands++;
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		if ((fd = new_fd) == -1)
+		{
+			return -2;
+		}
 
-			return 4;
+		/* The redirect isn't an argument of the command */
+		for (int j = i; args[j] != NULL; j++)
+		{
+			args[j] = args[j + tokens];
+			if (args[j] == NULL)
+			{
+				break;
+			}
 		}
 	}
-	counters.G_count_commands++;
-	return -1;
+	return fd;
 }
 
 /*******************************************************************************************************************
@@ -252,105 +322,113 @@ void nano_verify_terminate(char **args)
 
 
 /*******************************************************************************************************************
- * Function nano_verify_char
+ * Function nano_parse_list
  * ---------------------------------------------------------------------------------------------------------------
- *  @brief Function receives @param lineptr with the inserted command to verify if it was inserted any character
- *  	that isn't supported. First verifies if there is a TAB, SPACE or % in the first char( @param lineptr[0] ), after 
- *  	validates there isn't any of those it verifies the unsupported characters in the whole @param lineptr.
+ *  @brief Function receives the @param tokens from nano_split_lineptr and builds the command list in @param list.
+ * 		Every operator token is replaced by NULL, so each node of the list points to a NULL terminated slice of
+ * 		@param tokens that can be given to EXECVP. The nodes array of @param list is reused between calls and only
+ * 		grows when a line has more commands than any previous one, so no memory is allocated per command.
+ * 		A trailing ; is accepted (ex: ls ;), but a list can't start with an operator, have two operators in a row 
+ * 		or end with && or ||.
  * 
- * 	Unsupported characters: !, ", #, $, &, ', (, ), , , :, ;, <, =, ?, @, [, \, ], ^, `, {, |, }, ~
- * 
- * @return Function returns @param result with 0 if all characters are OK and -1 if one unsupported character is found
+ * @return Function returns 0 if the list is valid and -1 on a syntax error
  *******************************************************************************************************************/
-int nano_verify_char(char *lineptr)
+int nano_parse_list(char **tokens, struct NanoList *list)
 {
-	int res = 0;
-	size_t length = strlen(lineptr);
-	size_t i;
-
-	int verify[] = {33, 34, 35, 36, 38, 39, 40, 41, 42, 44, 58, 59, 60, 61, 63, 64, 91, 92, 93, 94, 96, 123, 124, 125 , 126};
+	int op = NANO_OP_SEQ;
+	char **start = tokens;
 
-	size_t verlength = sizeof(verify) / sizeof(verify[0]);
+	list->count = 0;
 
-	/* Verify SPACE and TAB and % in first char */
-	if (lineptr[0] == 32 || lineptr[0] == 9 || lineptr[0] == 37)
+	for (size_t i = 0;; i++)
 	{
-		return -1;
-	}
+		const char *next = tokens[i] != NULL ? nano_list_operator(tokens[i]) : NULL;
 
-	/* Verify other chars */
-	for (i = 0; i < length; i++)
-	{
-		for (size_t j = 0; j < verlength; j++)
+		/* Still inside a command */
+		if (tokens[i] != NULL && next == NULL)
+		{
+			continue;
+		}
+
+		/* Empty command: only valid at the end of the line after a ; */
+		if (&tokens[i] == start)
+		{
+			if (tokens[i] == NULL && op == NANO_OP_SEQ && list->count > 0)
+			{
+				return 0;
+			}
+			return -1;
+		}
+
+		if (list->count == list->capacity)
 		{
-			if (lineptr[i] == verify[j])
+			list->capacity = list->capacity + NANO_TOKENS_BUFSIZE;
+			list->nodes = REALLOC(list->nodes, list->capacity * sizeof(struct NanoNode));
+			if (list->nodes == NULL)
 			{
-				res = -1;
-				j = verlength;
-				i = length;
+				ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
 			}
 		}
+
+		list->nodes[list->count].args = start;
+		list->nodes[list->count].op = op;
+		list->count++;
+
+		if (tokens[i] == NULL)
+		{
+			return 0;
+		}
+
+		op = next[0] == ';' ? NANO_OP_SEQ : (next[0] == '&' ? NANO_OP_AND : NANO_OP_OR);
+		tokens[i] = NULL;
+		start = &tokens[i + 1];
 	}
-	return res;
 }
 
 
 /*******************************************************************************************************************
- * Function nano_verify_pointer
+ * Function nano_list_next
  * ---------------------------------------------------------------------------------------------------------------
- *  @brief Function receives the pointer @param ptr to verify if the memory was allocated correctly.
- *  	If the memory wasn't well allocated it sends and ERROR with a message	
+ *  @brief Function returns the index of the next command of @param list to execute, starting the search at 
+ * 		@param from, given the @param exit_status of the last executed command. A command after && only runs if the
+ * 		last status was 0 and a command after || only runs if it wasn't. Skipped commands keep the last status, so
+ * 		"false && a || b" executes b.
  * 
- * @return Functions returns void
+ * @return Function returns the index of the next command or -1 when the list is finished
  *******************************************************************************************************************/
-void nano_verify_pointer(char **ptr)
+ssize_t nano_list_next(const struct NanoList *list, size_t from, int exit_status)
 {
-	if (ptr == NULL)
+	for (size_t i = from; i < list->count; i++)
 	{
-		ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+		int op = list->nodes[i].op;
+
+		if (op == NANO_OP_SEQ || (op == NANO_OP_AND && exit_status == 0) || (op == NANO_OP_OR && exit_status != 0))
+		{
+			return (ssize_t)i;
+		}
 	}
+	return -1;
 }
 
 
 /*******************************************************************************************************************
- * Function nano_split_lineptr
+ * Function nano_exit_status
  * ---------------------------------------------------------------------------------------------------------------
- *  @brief Function to parse and split the given string @param lineptr and split in different tokens separated by SPACE, 
- * 		adding them to @param tokens and terminate each token with NULL. The last position of @param tokens is also set 
- * 		to NULL so it can be later used in EXECVP.
+ *  @brief Function converts the @param wstatus returned by waitpid into a shell exit status.
  * 
- * @return Function returns a pointer to @param tokens with the necessary arguments for the EXECVP.
+ * @return Function returns the exit code of the child, or 128 + signal number if it was killed by a signal
  *******************************************************************************************************************/
-char **nano_split_lineptr(char *lineptr)
+int nano_exit_status(int wstatus)
 {
-
-	char *token;
-	int buffersize = NANO_TOKENS_BUFSIZE;
-	char **tokens = malloc(buffersize * sizeof(char *));
-
-	int pos = 0;
-
-	nano_verify_pointer(tokens);
-
-	token = strtok(lineptr, " ");
-	while (token != NULL)
+	if (WIFEXITED(wstatus))
 	{
-		tokens[pos] = token;
-		pos++;
-
-		if (pos >= buffersize)
-		{
-			buffersize = buffersize + NANO_TOKENS_BUFSIZE;
-			tokens = realloc(tokens, buffersize * sizeof(char *));
-
-			nano_verify_pointer(tokens);
-		}
-		token = strtok(NULL, " ");
+		return WEXITSTATUS(wstatus);
 	}
-
-	tokens[pos] = NULL;
-
-	return tokens;
+	if (WIFSIGNALED(wstatus))
+	{
+		return 128 + WTERMSIG(wstatus);
+	}
+	return 1;
 }
 
 
@@ -367,8 +445,13 @@ char *nano_read_command(char *line)
 
 	size_t n = 0;
 	ssize_t result;
+	uint64_t start;
 
-	printf("nanoShell$ ");
+	if (!batch)
+	{
+		printf("nanoShell$ ");
+	}
+	start = nano_trace_now();
 	if ((result = getline(&line, &n, stdin)) == -1)
 	{
 		if (feof(stdin))
@@ -381,95 +464,402 @@ char *nano_read_command(char *line)
 		}
 	}
 	line[strcspn(line, "\n")] = 0;
+	nano_trace_span(NANO_TRACE_READ, start, 0, line);
 
 	return line;
 }
 
 
 /*******************************************************************************************************************
- * Function nano_exec_commands
+ * Function nano_tail_call_possible
  * ---------------------------------------------------------------------------------------------------------------
- *  @brief Function receives @param lineptr with the inserted command by the user and makes the validations for
- * 		unsupported characters, splits the string in tokens to be executed in EXECVP, verifies command for terminating
- * 		nanoShell and verifies for a redirect command. After, it creates a children process to verify @param result for
- * 		the possible redirect. If there is a redirect sets @param outputfile for the destination with the options 
- * 		from the @param result. 
- * 		If there isn't any error the function executes the command with EXECVP.
+ *  @brief Function verifies if the command with the redirect @param result can replace nanoShell, which is only
+ * 		when nothing is left to do after it exits: not with --trace, --record, --memo, --journal, --watch, 
+ * 		--capture or --metrics-socket, nor with >z and >>z, whose output is compressed by nanoShell.
  * 
- * @return Function returns void
+ * @return Function returns 1 if it can and 0 otherwise
  *******************************************************************************************************************/
-void nano_exec_commands(char *lineptr)
+int nano_tail_call_possible(int result)
 {
-	char **args;
+	return result != 5 && result != 6 && !nano_trace_enabled && !nano_record_enabled && !nano_memo_enabled &&
+		   !nano_journal_enabled && !nano_watch_enabled && !nano_capture_enabled && !nano_metrics_enabled;
+}
 
-	if (lineptr[0] != 0)
+
+/*******************************************************************************************************************
+ * Function nano_exec_simple
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function receives @param args with one command of a list, separates the leading NAME=value 
+ * 		@param assigns, verifies command for terminating nanoShell and verifies for a redirect command. 
+ * 		A line with only assignments sets them in the environment of nanoShell.
+ * 		After, it creates a children process to verify @param result for the possible redirect. If there is a 
+ * 		redirect sets @param outputfile for the destination with the options from the @param result. 
+ * 		If there isn't any error the function executes the command with EXECVPE, with the assignments overlaid on
+ * 		the environment of nanoShell, and waits for it. For >z and >>z nanoShell compresses the stdout of the
+ * 		command from a pipe into @param outputfile before waiting. An input redirect (<, << or <<<) is the
+ * 		stdin of the command.
+ * 		If @param tail the command is the last one nanoShell executes: when nothing is left to do after it, it
+ * 		is executed in the process of nanoShell, without fork, and its exit status is the one of nanoShell.
+ * 
+ * @return Function returns the exit status of the command
+ *******************************************************************************************************************/
+int nano_exec_simple(char **args, int tail)
+{
+	char *outputfile;
+	int result;
+	int wstatus;
+	int exec_pipe[2] = {-1, -1};
+	int compress_pipe[2] = {-1, -1};
+	int compress_fd = -1;
+	int input_fd;
+	uint64_t start;
+	uint64_t probe_start = 0;
+	uint64_t launch;
+	char **assigns = args;
+	size_t n_assigns = nano_env_assignments(args);
+
+	nano_record_start(assigns);
+
+	args = &args[n_assigns];
+	if (args[0] == NULL)
+	{
+		nano_env_export(assigns, n_assigns);
+		nano_record_end(-1, 0);
+		return 0;
+	}
+
+	nano_verify_terminate(args);
+
+	/* Builtin stats [--top N] */
+	if (strcmp(args[0], "stats") == 0)
 	{
+		result = nano_stats_builtin(args);
+		nano_record_end(-1, result);
+		return result;
+	}
 
-		int res = nano_verify_char(lineptr);
-		if (res == -1)
+	/* Verify if it has an input redirect */
+	input_fd = nano_verify_input(args);
+	if (input_fd == -2)
+	{
+		nano_record_end(-1, 1);
+		return 1;
+	}
+
+	/* Builtin xargs: each batch is executed (and recorded) as a command */
+	if (strcmp(args[0], "xargs") == 0)
+	{
+		return nano_xargs_builtin(assigns, n_assigns, args, input_fd, nano_exec_simple);
+	}
+
+	/* Verify if it is a redirect command */
+	start = nano_trace_now();
+	result = nano_verify_redirect(args, &outputfile);
+	nano_trace_span(NANO_TRACE_REDIRECT, start, 0, args[0]);
+
+	if (NANO_PROBE_ENABLED(command_parsed))
+	{
+		NANO_PROBE4(command_parsed, (int)getpid(), args[0], result, nano_time_ns() - probe_line_start);
+	}
+
+	/* A redirected command identical to an earlier run is restored from the --memo cache (unless its input is
+	 * redirected, which isn't in the key, or its output compressed, which isn't cached) */
+	if (nano_memo_enabled && result > 0 && result < 5 && input_fd == -1)
+	{
+		if (nano_memo_lookup(assigns, result, outputfile))
 		{
-			printf("[ERROR] Wrong request ' %s'\n", lineptr);
+			counters->G_count_memo_hits++;
+			nano_record_end(result, 0);
+			return 0;
+		}
+		counters->G_count_memo_misses++;
+	}
+
+	/* Wait for a token of --rate before the launch */
+	if (nano_ratelimit_enabled)
+	{
+		start = nano_trace_now();
+		nano_ratelimit_acquire();
+		nano_trace_span(NANO_TRACE_THROTTLE, start, 0, args[0]);
+	}
+
+	/* For >z and >>z the file is written by nanoShell, with what it reads from the stdout of the command */
+	if (result == 5 || result == 6)
+	{
+		if (nano_compress_name == NULL)
+		{
+			printf("[ERROR] nanoShell was built without zstd or zlib for >z\n");
 		}
 		else
 		{
-			char *outputfile;
-			int result;
+			compress_fd = open(outputfile, O_WRONLY | O_CREAT | O_CLOEXEC | (result == 6 ? O_APPEND : O_TRUNC), 0666);
+			if (compress_fd == -1 || pipe2(compress_pipe, O_CLOEXEC) == -1)
+			{
+				printf("[ERROR]Error opening file\n");
+				if (compress_fd != -1)
+				{
+					close(compress_fd);
+					compress_fd = -1;
+				}
+			}
+		}
+		if (compress_fd == -1)
+		{
+			if (input_fd != -1)
+			{
+				close(input_fd);
+			}
+			nano_record_end(result, 1);
+			return 1;
+		}
+	}
 
-			args = nano_split_lineptr(lineptr);
+	/* When tracing, the end of exec is seen in the parent as EOF on a close-on-exec pipe */
+	if ((nano_trace_enabled || nano_metrics_enabled) && pipe2(exec_pipe, O_CLOEXEC) == -1)
+	{
+		WARNING("pipe2 for exec trace");
+	}
 
-			nano_verify_terminate(args);
+	if (NANO_PROBES_ENABLED())
+	{
+		probe_start = nano_time_ns();
+	}
 
-			/* Verify if it is a redirect command */
-			result = nano_verify_redirect(args, &outputfile);
+	/* With --capture the stdout and stderr not redirected to a file are pipes read by nanoShell (not with >z, 
+	 * whose pipe is already read) */
+	if (nano_capture_enabled && result != 5 && result != 6 && nano_capture_prepare(result) == -1)
+	{
+		ERROR(NANO_ERROR_IO, "Error creating the pipes of --capture\n");
+	}
 
-			pid_t pid = fork();
-			if (pid == -1)
-			{
-				ERROR(NANO_ERROR_FORK, "Error executing fork().\n");
-			}
-			else if (pid == 0)
-			{
-				FILE *fp;
+	/* The child would write again what is still in the buffer, and should read stdin from where nanoShell is */
+	fflush(stdout);
+	if (batch)
+	{
+		fflush(stdin);
+	}
 
-				switch (result)
-				{
-				case 1:
-					printf("[INFO] stdout redirect to %s\n", outputfile);
-					fp = freopen(outputfile, "w", stdout);
-					break;
-				case 2:
-					printf("[INFO] stdout redirect to %s\n", outputfile);
-					fp = freopen(outputfile, "a", stdout);
-					break;
-				case 3:
-					printf("[INFO] stderr redirect to %s\n", outputfile);
-					fp = freopen(outputfile, "w", stderr);
-					break;
-				case 4:
-					printf("[INFO] stderr redirect to %s\n", outputfile);
-					fp = freopen(outputfile, "a", stderr);
-					break;
-				default:
-					break;
-				}
-				if (fp == NULL)
-				{
-					printf("[ERROR]Error opening file\n");
-				}
+	/* The last command replaces nanoShell: no fork, nor a zombie to reap */
+	tail = tail && nano_tail_call_possible(result);
+	if (tail)
+	{
+		DEBUG("tail call of %s", args[0]);
+		fflush(stderr);
+		nano_counters_close();
+	}
 
-				/* Execute commands */
-				execvp(args[0], args);
-				ERROR(NANO_ERROR_EXECVP, "Error executing execvp.\n");
+	start = nano_trace_now();
+	launch = nano_time_ns();
+	pid_t pid = tail ? 0 : fork();
+	if (pid == -1)
+	{
+		ERROR(NANO_ERROR_FORK, "Error executing fork().\n");
+	}
+	else if (pid == 0)
+	{
+		FILE *fp = stdout; // The stream of the redirect, stdout if there is none
+		uint64_t open_start = NANO_PROBE_ENABLED(redirect_opened) ? nano_time_ns() : 0;
 
-				exit(0);
+		if (exec_pipe[0] != -1)
+		{
+			close(exec_pipe[0]);
+		}
+		if (input_fd != -1 && dup2(input_fd, STDIN_FILENO) == -1)
+		{
+			printf("[ERROR]Error redirecting stdin\n");
+		}
+		/* The message goes to the stdout of nanoShell, so it is flushed before the pipes of --capture replace it */
+		if (!batch && result >= 1 && result <= 6)
+		{
+			if (result >= 5)
+			{
+				printf("[INFO] stdout redirect to %s (%s)\n", outputfile, nano_compress_name);
 			}
 			else
 			{
-				wait(NULL);
-				free(args);
+				printf("[INFO] %s redirect to %s\n", result <= 2 ? "stdout" : "stderr", outputfile);
 			}
+			fflush(stdout);
+		}
+		if (nano_capture_enabled)
+		{
+			nano_capture_child();
+		}
+
+		switch (result)
+		{
+		case 1:
+			fp = freopen(outputfile, "w", stdout);
+			break;
+		case 2:
+			fp = freopen(outputfile, "a", stdout);
+			break;
+		case 3:
+			fp = freopen(outputfile, "w", stderr);
+			break;
+		case 4:
+			fp = freopen(outputfile, "a", stderr);
+			break;
+		case 5:
+		case 6:
+			fp = dup2(compress_pipe[1], STDOUT_FILENO) == -1 ? NULL : stdout;
+			break;
+		default:
+			break;
+		}
+		if (fp == NULL)
+		{
+			printf("[ERROR]Error opening file\n");
+		}
+		else if (result != -1 && NANO_PROBE_ENABLED(redirect_opened))
+		{
+			NANO_PROBE5(redirect_opened, (int)getpid(), args[0], result, nano_time_ns() - open_start, outputfile);
+		}
+
+		/* Execute commands */
+		nano_affinity_apply();
+		nano_priority_apply();
+		execvpe(args[0], args, nano_env_overlay(assigns, n_assigns));
+		if (NANO_PROBE_ENABLED(exec_failed))
+		{
+			NANO_PROBE5(exec_failed, (int)getpid(), args[0], result, nano_time_ns() - probe_start, errno);
+		}
+		ERROR(NANO_ERROR_EXECVP, "Error executing execvp.\n");
+
+		exit(0);
+	}
+	nano_trace_span(NANO_TRACE_FORK, start, 0, args[0]);
+	counters->G_count_inflight++;
+	if (input_fd != -1)
+	{
+		close(input_fd);
+	}
+	DEBUG("launched %s (pid %d, redirect %d)", args[0], (int)pid, result);
+
+	if (NANO_PROBE_ENABLED(child_forked))
+	{
+		NANO_PROBE4(child_forked, (int)pid, args[0], result, nano_time_ns() - probe_start);
+	}
+
+	if (exec_pipe[0] != -1)
+	{
+		char c;
+		uint64_t spawn;
+
+		start = nano_trace_now();
+		close(exec_pipe[1]);
+		while (read(exec_pipe[0], &c, 1) == -1 && errno == EINTR)
+			;
+		close(exec_pipe[0]);
+		nano_trace_span(NANO_TRACE_EXEC, start, pid, args[0]);
+		spawn = nano_time_ns() - launch;
+		counters->G_spawn_buckets[nano_spawn_bucket(spawn)]++;
+		counters->G_spawn_sum_ns += spawn;
+	}
+
+	if (nano_capture_enabled)
+	{
+		nano_capture_collect(pid);
+	}
+
+	if (compress_fd != -1)
+	{
+		struct NanoCompressStats stats;
+
+		close(compress_pipe[1]);
+		if (nano_compress_stream(compress_pipe[0], compress_fd, &stats) == -1)
+		{
+			WARNING("Error compressing the output of %s to %s", args[0], outputfile);
+		}
+		close(compress_pipe[0]);
+		close(compress_fd);
+
+		if (!batch)
+		{
+			printf("[INFO] %s: %llu -> %llu bytes (ratio %.2f), %.1f MB/s\n", outputfile, 
+				   (unsigned long long)stats.in, (unsigned long long)stats.out, 
+				   stats.out > 0 ? (double)stats.in / (double)stats.out : 0.0,
+				   stats.ns > 0 ? (double)stats.in * 1e3 / (double)stats.ns : 0.0);
+		}
+	}
+
+	start = nano_trace_now();
+	if (waitpid(pid, &wstatus, 0) == -1)
+	{
+		counters->G_count_inflight--;
+		return 1;
+	}
+	counters->G_count_inflight--;
+	counters->G_count_failures += nano_exit_status(wstatus) != 0;
+	nano_trace_span(NANO_TRACE_WAIT, start, pid, args[0]);
+	nano_stats_record(args[0], nano_exit_status(wstatus), nano_time_ns() - launch);
+	nano_record_end(result, nano_exit_status(wstatus));
+	nano_memo_store(nano_exit_status(wstatus));
+	DEBUG("reaped %s (pid %d, exit status %d)", args[0], (int)pid, nano_exit_status(wstatus));
+
+	if (NANO_PROBE_ENABLED(child_reaped))
+	{
+		NANO_PROBE5(child_reaped, (int)pid, args[0], result, nano_time_ns() - probe_start, nano_exit_status(wstatus));
+	}
+
+	return nano_exit_status(wstatus);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_exec_commands
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function receives @param lineptr with the inserted command by the user and makes the validations for
+ * 		unsupported characters, splits the string in tokens and builds the command list joined by ;, && and ||.
+ * 		The list is evaluated from left to right with nano_list_next, executing each command with nano_exec_simple
+ * 		and using its exit status to decide if the commands after && and || are executed.
+ * 
+ * @return Function returns the exit status of the last executed command (0 for an empty line, 1 for a wrong request)
+ *******************************************************************************************************************/
+int nano_exec_commands(char *lineptr)
+{
+	static struct NanoList list;
+	char **args;
+	int exit_status = 0;
+
+	if (lineptr[0] != 0)
+	{
+
+		uint64_t start = nano_trace_now();
+		if (NANO_PROBE_ENABLED(command_parsed))
+		{
+			probe_line_start = nano_time_ns();
+		}
+
+		int res = nano_verify_char(lineptr);
+		nano_trace_span(NANO_TRACE_VALIDATE, start, 0, lineptr);
+		if (res == -1)
+		{
+			printf("[ERROR] Wrong request ' %s'\n", lineptr);
+			return 1;
+		}
+
+		start = nano_trace_now();
+		args = nano_split_lineptr(lineptr);
+		res = nano_parse_list(args, &list);
+		nano_trace_span(NANO_TRACE_SPLIT, start, 0, args[0]);
+
+		if (res == -1)
+		{
+			printf("[ERROR] Wrong request: misplaced ';', '&&' or '||'\n");
+			FREE(args);
+			return 1;
 		}
+
+		for (ssize_t i = nano_list_next(&list, 0, 0); i != -1; i = nano_list_next(&list, i + 1, exit_status))
+		{
+			exit_status = nano_exec_simple(list.nodes[i].args, tail_call && (size_t)i == list.count - 1);
+		}
+
+		FREE(args);
+		nano_trace_idle();
 	}
+	return exit_status;
 }
 
 /*******************************************************************************************************************
@@ -493,12 +883,19 @@ void nano_loop(void)
 
 		lineptr = nano_read_command(line);
 
-		nano_exec_commands(lineptr);
+		/* The lines of the here-documents follow the command line */
+		nano_capture_line++;
+		if (nano_heredoc_collect(lineptr, stdin, batch ? NULL : "> ") != -1)
+		{
+			nano_exec_commands(lineptr);
+		}
+		nano_heredoc_clear();
 
-		free(line);
+		/* getline allocates the line in nano_read_command */
+		free(lineptr);
 
 		// If nanoShell is started with -m option
-		if (counters.G_max_commands > 0 && counters.G_count_commands == counters.G_max_commands) {
+		if (counters->G_max_commands > 0 && counters->G_count_commands >= counters->G_max_commands) {
 			status = 1;
 		}
 
@@ -506,27 +903,145 @@ void nano_loop(void)
 }
 
 /*******************************************************************************************************************
- * Function main
+ * Function nano_file_last
  * ---------------------------------------------------------------------------------------------------------------
- *  @brief Function main starts the commands counters from the @struct counters. 
- * 		Function handles the options given when starting nanoShell:
- * 				
- * 				-s : Creates a file "signals.txt" with the complete possible signals to send to nanoShell
- * 				-m : Terminates after a given int value of commands.
- * 				-f : Reads from a given file to execute commands.
+ *  @brief Function verifies if there isn't any command line after the current position of @param fileptr, which
+ *		is kept. Only the lines up to the next command line are read.
  * 
- * 
- * @return Function returns a int value depending on the event. 0 if OK.
+ * @return Function returns 1 if there isn't and 0 if there is (or the position can't be kept)
  *******************************************************************************************************************/
-int main(int argc, char *argv[])
+int nano_file_last(FILE *fileptr)
 {
-	/* Disable warnings */
-	(void)argc;
-	(void)argv;
+	long position = ftell(fileptr);
+	char *lineptr = NULL;
+	size_t n = 0;
+	int last = position != -1;
 
-	counters.G_count_commands = 0;
-	counters.G_count_stderr = 0;
-	counters.G_count_stdout = 0;
+	//Verifies for #, [LINE FEED], [SPACE], [HORIZONTAL TAB] to ignore line, as nano_exec_file
+	while (last && getline(&lineptr, &n, fileptr) != -1)
+	{
+		last = lineptr[0] == 35 || lineptr[0] == 10 || lineptr[0] == 32 || lineptr[0] == 9;
+	}
+	free(lineptr);
+	return fseek(fileptr, position, SEEK_SET) == 0 && last;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_exec_file
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function executes the command lines of the script @param fileptr (option -f): one after the other, or
+ * 		as a DAG on @param jobs workers if it isn't 0. The lines done in the run resumed with --journal, or 
+ * 		unchanged since the last run of --watch, are skipped. The last command replaces nanoShell, if it can.
+ * 		If the line starts with #, [LINE FEED], [SPACE] or [HORIZONTAL TAB] it is ignored, except the #@inputs 
+ * 		and #@priority annotations of the next line.
+ * 
+ * @return Function returns the exit status of the last command line (0 if it was skipped, 1 if its 
+ * 		here-document is missing), or C_EXIT_FAILURE if the DAG can't be run or didn't complete
+ *******************************************************************************************************************/
+int nano_exec_file(FILE *fileptr, unsigned int jobs)
+{
+	char *lineptr = NULL;
+	size_t n = 0;
+	ssize_t result;
+	int i = 1;
+	unsigned int number = 0;
+	int last_status = C_EXIT_SUCCESS; // Of the last command line, as if it had replaced nanoShell
+
+	if (jobs > 0)
+	{
+		return nano_dag_run(fileptr, jobs, nano_exec_commands) == 0 ? C_EXIT_SUCCESS : C_EXIT_FAILURE;
+	}
+
+	uint64_t start = nano_trace_now();
+	while ((result = getline(&lineptr, &n, fileptr)) != -1)
+	{
+		nano_trace_span(NANO_TRACE_READ, start, 0, lineptr);
+		lineptr[strcspn(lineptr, "\n")] = 0;
+		number++;
+		//Input files of the next line for --memo
+		if (strncmp(lineptr, NANO_MEMO_ANNOTATION, strlen(NANO_MEMO_ANNOTATION)) == 0)
+		{
+			nano_memo_inputs(lineptr + strlen(NANO_MEMO_ANNOTATION));
+		}
+		//Priority of the next line
+		else if (strncmp(lineptr, NANO_PRIORITY_ANNOTATION, strlen(NANO_PRIORITY_ANNOTATION)) == 0)
+		{
+			struct NanoPriority prio;
+
+			if (nano_priority_parse(lineptr + strlen(NANO_PRIORITY_ANNOTATION), &prio) == -1)
+			{
+				printf("[ERROR] Wrong annotation '%s': expected '#@priority NICE [CLASS[:LEVEL]]'\n", lineptr);
+			}
+			else
+			{
+				nano_priority_set(&prio);
+			}
+		}
+		//Verifies for #, [LINE FEED], [SPACE], [HORIZONTAL TAB] to ignore line
+		else if (lineptr[0] != 35 && lineptr[0] != 0 && lineptr[0] != 32 && lineptr[0] != 9)
+		{
+			/* The lines of the here-documents are read even if the line was done */
+			int heredoc_lines = nano_heredoc_collect(lineptr, fileptr, NULL);
+
+			last_status = heredoc_lines == -1 ? 1 : C_EXIT_SUCCESS;
+			if (nano_journal_done(number))
+			{
+				printf("[resumed #%d]: %s\n", i, lineptr);
+			}
+			else if (nano_watch_done(number))
+			{
+				printf("[unchanged #%d]: %s\n", i, lineptr);
+			}
+			else if (heredoc_lines != -1)
+			{
+				int exit_status;
+
+				printf("[command #%d]: %s\n", i, lineptr);
+				nano_capture_line = number;
+				tail_call = nano_tail_call_possible(-1) && nano_file_last(fileptr);
+				exit_status = nano_exec_commands(lineptr);
+				nano_journal_record(number, exit_status);
+				nano_watch_record(number, exit_status);
+				last_status = exit_status;
+			}
+			number += heredoc_lines > 0 ? (unsigned int)heredoc_lines : 0;
+			nano_heredoc_clear();
+			nano_memo_inputs(NULL);
+			nano_priority_set(NULL);
+			i++;
+		}
+		start = nano_trace_now();
+	}
+
+	free(lineptr);
+	return last_status;
+}
+
+/*******************************************************************************************************************
+ * Function main
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function main starts the commands counters from the @struct counters. 
+ * 		Function handles the options given when starting nanoShell:
+ * 				
+ * 				-s : Creates a file "signals.txt" with the complete possible signals to send to nanoShell
+ * 				-m : Terminates after a given int value of commands.
+ * 				-f : Reads from a given file to execute commands.
+ * 
+ * 
+ * @return Function returns a int value depending on the event. 0 if OK.
+ *******************************************************************************************************************/
+int main(int argc, char *argv[])
+{
+	/* Disable warnings */
+	(void)argc;
+	(void)argv;
+
+	nano_stats_init();
+
+	nano_env_init();
+
+	nano_priority_inherit();
 
 	struct gengetopt_args_info args;
 
@@ -536,6 +1051,112 @@ int main(int argc, char *argv[])
 		exit(C_EXIT_FAILURE);
 	}
 
+	/* Only --repeat takes a command after its options (--repeat N -- command) */
+	if (args.inputs_num > 0 && !args.repeat_given)
+	{
+		printf("[ERROR] Unexpected argument \'%s\' (a command is only accepted after --repeat N --).\n\n", 
+			   args.inputs[0]);
+		exit(C_ERROR_PARSING_ARGS);
+	}
+
+	/*******************************************************************************************************************
+	 * Top option: --top {pid}
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given nanoShell doesn't execute commands: it shows every second the counters of the 
+	 * 		nanoShell with the given PID, read from its segment in /dev/shm, until it exits.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.top_given)
+	{
+		exit(nano_counters_top((pid_t)args.top_arg));
+	}
+
+	counters = nano_counters_open();
+
+	/*******************************************************************************************************************
+	 * Batch option: --batch
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given, or stdin isn't a terminal, nanoShell doesn't print the prompt nor the [INFO] 
+	 * 		messages of the redirects, and stdin and stdout are fully buffered with large buffers. Both are 
+	 * 		flushed before each fork. It must be set before anything is written to stdout.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.batch_given || !isatty(STDIN_FILENO))
+	{
+		batch = 1;
+		setvbuf(stdin, NULL, _IOFBF, NANO_BATCH_BUFSIZE);
+		setvbuf(stdout, NULL, _IOFBF, NANO_BATCH_BUFSIZE);
+	}
+
+	/*******************************************************************************************************************
+	 * Allocation statistics option: --memstats
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given the allocations made with MALLOC/REALLOC are counted per call site (live and peak
+	 * 		bytes, allocations and frees), and written to a file next to the status file on SIGUSR2.
+	 * 		It must be enabled before anything is allocated with MALLOC.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.memstats_given)
+	{
+		eipa_mem_accounting();
+	}
+
+	/*************************************************************
+	 * SAVE TIMESTAMP FOR NANOSHELL STARTUP
+	 * 
+	 *************************************************************/
+	time_t starttime = time(NULL);
+
+	if (starttime == -1)
+	{
+		printf("The time() function failed");
+		return 1;
+	}
+
+	ptm = localtime(&starttime);
+
+	if (ptm == NULL)
+	{
+		printf("The localtime() function failed");
+		return 1;
+	}
+
+	/*************************************************************
+	 * SIGNAL HANDLER
+	 * 
+	 *************************************************************/
+	struct sigaction act;
+
+	/* Defines routine to handle signals */
+	act.sa_sigaction = nano_sig_handler;
+
+	/* empty signals mask -- dont block signals */
+	sigemptyset(&act.sa_mask);
+
+	act.sa_flags = SA_SIGINFO;	/*Additional info about signals */
+	act.sa_flags |= SA_RESTART; /*recovers from blocking calls*/
+
+	/* Captures signal SIGUSR1 */
+	if (sigaction(SIGUSR1, &act, NULL) < 0)
+	{
+		ERROR(NANO_ERROR_SIGACTION, "sigaction - SIGUSR1");
+	}
+	/* Captures signal SIGUSR2 */
+	if (sigaction(SIGUSR2, &act, NULL) < 0)
+	{
+		ERROR(NANO_ERROR_SIGACTION, "sigaction - SIGUSR2");
+	} /* Captures signal SIGUSR1 */
+	if (sigaction(SIGINT, &act, NULL) < 0)
+	{
+		ERROR(NANO_ERROR_SIGACTION, "sigaction - SIGINT");
+	}
+	/* Captures signal SIGRTMIN (log level) */
+	if (sigaction(SIGRTMIN, &act, NULL) < 0)
+	{
+		ERROR(NANO_ERROR_SIGACTION, "sigaction - SIGRTMIN");
+	}
+
+
 	/*******************************************************************************************************************
 	 * Help option: -h
 	 * ---------------------------------------------------------------------------------------------------------------
@@ -550,21 +1171,57 @@ int main(int argc, char *argv[])
 
 		
 		printf("\v\t# Use simple commands without metachars and pipes (ex: ps aux -l)\n");
+		printf("\t# Chain commands with ;, && and || (ex: make && ./app || echo failed)\n");
+		printf("\t# Set variables for one command with NAME=value (ex: LC_ALL=C sort file)\n");
+		printf("\t# Use stats [--top N] to see the calls and time of each executable\n");
+		printf("\t# Use xargs [-P N] [-n MAX] command to execute it with the lines of stdin (ex: xargs -P 4 gzip < list)\n");
 		printf("\t# Use bye command to exit nanoShell\n");
 
 		printf("\vOptions:\n");
 		
 		printf("\v  -f \t\tfile \t\t- run a list of commands in a file (filename argument). Each line should be a command\n");
+		printf("  -c \t\tcommand \t- executes a command line and terminates with its exit status\n");
 		printf("  -h \t\thelp \t\t- shows a brief summary of options and arguments of each available option\n");
 		printf("  -m \t\tmax \t\t- define the maximum number of commands the nanoShell should execute before terminating\n");
 		printf("  -s \t\tsignal file \t- creates a 'signal.txt' file with all available commands that can send signals to the nanoShell.\n");
+		printf("  --trace \ttrace file \t- writes the phases of every command to a Chrome trace-event file (Perfetto)\n");
+		printf("  --record \trecord file \t- records every executed command, with its timing and exit status\n");
+		printf("  --replay \trecord file \t- executes again a recording with its original timing and reports commands/sec\n");
+		printf("  --speed \tfactor \t\t- speed of --replay (default 1, 0 for as fast as possible)\n");
+		printf("  --memstats \t\t\t- counts allocations per call site, written to a file on SIGUSR2\n");
+		printf("  --repeat \tN \t\t- executes the command after -- N times and prints latency percentiles and throughput\n");
+		printf("  --rate \tR/s \t\t- schedules the executions of --repeat at a fixed rate (open-loop), otherwise limits\n\t\t\t\t  the launches with a token bucket\n");
+		printf("  --burst \tB \t\t- launches allowed at once by the --rate token bucket (default 1)\n");
+		printf("  --batch \t\t\t- no prompt nor [INFO] messages of the redirects, the default when stdin isn't a terminal\n");
+		printf("  --memo \tDIR \t\t- restores the redirect output of identical earlier runs from the cache DIR\n");
+		printf("  --memo-env \tA,B \t\t- environment variables in the keys of --memo\n");
+		printf("  --cpus \tLIST \t\t- pins the commands to the CPUs of LIST (ex: 0-3,8)\n");
+		printf("  --placement \trr|pack|numa \t- each command on the next CPU, all on all the CPUs or each on the next NUMA node\n");
+		printf("  --shell-cpu \tCPU \t\t- pins nanoShell to CPU, apart from the commands\n");
+		printf("  --nice \tN \t\t- niceness of the commands, or of a #@priority NICE [CLASS[:LEVEL]] line in -f\n");
+		printf("  --ionice \tCLASS[:LEVEL] \t- I/O scheduling class (rt, be or idle) and level (0-7) of the commands\n");
+		printf("  --journal \tFILE \t\t- writes the lines of -f completed to FILE, to be skipped with --resume\n");
+		printf("  --resume \t\t\t- skips the lines of -f completed with exit status 0 in the --journal\n");
+		printf("  --top \tPID \t\t- shows every second the counters of the nanoShell PID, read from /dev/shm\n");
+		printf("  --capture \tFILE \t\t- appends the stdout and stderr of the commands to FILE as JSON lines\n");
+		printf("  --metrics-socket PATH \t- serves the counters in the Prometheus text format on the Unix socket PATH\n");
+		printf("  --watch \t\t\t- runs the -f file again each time it is written, only the lines changed and after them\n");
+		printf("  --jobs \tN \t\t- runs the -f file as a DAG of #@id NAME [after A,B] annotations on N workers\n");
 
 		printf("\vArguments:\n");
 
-		printf("\v  -f, --file <fich>\n");
+		printf("\v  -f, --file <fich> [--jobs <int>] [--journal <fich> [--resume] | --watch]\n");
 		printf("  -h, --help\n");
 		printf("  -m, --max <int>\n");
-		printf("  -s, --signalfile\n\n");
+		printf("  -s, --signalfile\n");
+		printf("  --trace <fich>\n");
+		printf("  --record <fich>\n");
+		printf("  --replay <fich> [--speed <double>]\n");
+		printf("  --repeat <int> [--rate <R/s>] -- <command>\n");
+		printf("  --rate <R/s> [--burst <int>]\n");
+		printf("  --memo <dir> [--memo-env <A,B>]\n");
+		printf("  --cpus <list> [--placement <rr|pack|numa>] [--shell-cpu <int>]\n");
+		printf("  --nice <int> [--ionice <CLASS[:LEVEL]>]\n\n");
 
 		return C_EXIT_SUCCESS;
 	}
@@ -585,8 +1242,148 @@ int main(int argc, char *argv[])
 		}
 		else
 		{
-			counters.G_max_commands = args.max_arg;
-			printf("[INFO] nanoShell with terminate after %d commands\n", counters.G_max_commands);
+			counters->G_max_commands = args.max_arg;
+			printf("[INFO] nanoShell with terminate after %d commands\n", counters->G_max_commands);
+		}
+	}
+
+	/*******************************************************************************************************************
+	 * Trace option: --trace {file}
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given nanoShell writes the spans of reading, validating, splitting, redirect detection,
+	 * 		fork, exec and wait of every command to the given file, in the Chrome trace-event format.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.trace_given)
+	{
+		if (nano_trace_open(args.trace_arg) == -1)
+		{
+			ERROR(NANO_ERROR_IO, "Error opening %s for writing!\n", args.trace_arg);
+		}
+	}
+
+	/*******************************************************************************************************************
+	 * Record option: --record {file}
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given every command executed is written to the given file in a compact binary log, 
+	 * 		with the time since the start of the recording, the redirect and the exit status.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.record_given)
+	{
+		if (nano_record_open(args.record_arg) == -1)
+		{
+			ERROR(NANO_ERROR_IO, "Error opening %s for writing!\n", args.record_arg);
+		}
+	}
+
+	/*******************************************************************************************************************
+	 * Rate limit option: --rate {R/s} [--burst {int}]
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given (without --repeat) every launch takes a token of a bucket refilled at the given
+	 * 		rate and holding up to --burst tokens (default 1), waiting for the next token when it is empty.
+	 * 		The time spent waiting is written to the status file on SIGUSR2.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.rate_given && !args.repeat_given)
+	{
+		double rate = 0;
+
+		if (nano_parse_rate(args.rate_arg, &rate) == -1 || rate <= 0 || args.burst_arg <= 0)
+		{
+			printf("[ERROR] Invalid value \'R/s\' for --rate or \'int\' for --burst.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+		nano_ratelimit_init(rate, (unsigned int)args.burst_arg);
+	}
+
+	/*******************************************************************************************************************
+	 * Memo option: --memo {dir} [--memo-env {A,B}]
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given the output of every redirected command that exits with 0 is kept in the given 
+	 * 		directory, keyed by its arguments, redirect, working directory, the --memo-env variables and the 
+	 * 		files of a "#@inputs A,B" line before it in -f. An identical command later gets the output restored
+	 * 		instead of being executed. The hits and misses are written to the status file on SIGUSR2.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.memo_given)
+	{
+		if (nano_memo_open(args.memo_arg, args.memo_env_arg) == -1)
+		{
+			ERROR(NANO_ERROR_IO, "Error creating the directory %s\n", args.memo_arg);
+		}
+	}
+
+	/*******************************************************************************************************************
+	 * CPU placement options: --cpus {list} [--placement {rr|pack|numa}] [--shell-cpu {int}]
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If any option is given every command is pinned, before exec, to the CPUs of the list (the CPUs of
+	 * 		nanoShell by default): each to the next CPU (rr), all to all of them (pack) or each to the ones of
+	 * 		the next NUMA node (numa). With --shell-cpu nanoShell is pinned to that CPU, apart from the commands.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.cpus_given || args.placement_given || args.shell_cpu_given)
+	{
+		int policy = nano_affinity_parse_policy(args.placement_arg);
+
+		if (policy == -1)
+		{
+			printf("[ERROR] Invalid value \'rr|pack|numa\' for --placement.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+		if (nano_affinity_init(args.cpus_arg, policy, args.shell_cpu_given ? args.shell_cpu_arg : -1) == -1)
+		{
+			printf("[ERROR] Invalid value \'LIST\' for --cpus or \'int\' for --shell-cpu.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+	}
+
+	/*******************************************************************************************************************
+	 * Priority options: --nice {int} [--ionice {rt|be|idle}[:{int}]]
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given every command is started with that niceness and I/O scheduling class and level,
+	 * 		unless a "#@priority NICE [CLASS[:LEVEL]]" line before it in -f says otherwise. With --jobs the 
+	 * 		ready commands are also launched by priority.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.nice_given || args.ionice_given)
+	{
+		if (nano_priority_init(args.nice_given ? args.nice_arg : NANO_NICE_INHERIT, args.ionice_arg) == -1)
+		{
+			printf("[ERROR] Invalid value \'int\' for --nice or \'CLASS[:LEVEL]\' for --ionice.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+	}
+
+	/*******************************************************************************************************************
+	 * Capture option: --capture {file}
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given the stdout and stderr of the commands (the ones not redirected to a file) are 
+	 * 		read by nanoShell and appended to the given file as JSON lines, one for each chunk read, with the line
+	 * 		of the command, its PID, the stream, the time and the data.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.capture_given)
+	{
+		if (nano_capture_open(args.capture_arg) == -1)
+		{
+			ERROR(NANO_ERROR_IO, "Error opening %s for writing!\n", args.capture_arg);
+		}
+	}
+
+	/*******************************************************************************************************************
+	 * Metrics option: --metrics-socket {path}
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given the counters of the commands, redirects, failures, children running and the
+	 * 		histogram of the spawn latency are served in the Prometheus text format on a Unix socket at the given
+	 * 		path, by a server process that reads them from the shared memory.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.metrics_socket_given)
+	{
+		if (nano_metrics_open(args.metrics_socket_arg) == -1)
+		{
+			ERROR(NANO_ERROR_IO, "Error listening on %s\n", args.metrics_socket_arg);
 		}
 	}
 
@@ -610,26 +1407,41 @@ int main(int argc, char *argv[])
 		}
 		pid_t pid = getpid();
 
-		fprintf(fileptr, "kill -SIGINT %d\nkill -SIGUSR1 %d\nkill -SIGUSR2 %d", pid, pid, pid);
+		fprintf(fileptr, "kill -SIGINT %d\nkill -SIGUSR1 %d\nkill -SIGUSR2 %d\nkill -SIGRTMIN %d", pid, pid, pid, pid);
 
 		fclose(fileptr);
 	}
 
+	/*******************************************************************************************************************
+	 * Command option: -c {command line}
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given nanoShell executes the command line and terminates with its exit status. Its
+	 * 		last command replaces nanoShell, if it can, so nanoShell as a wrapper doesn't cost an extra fork.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.command_given)
+	{
+		tail_call = 1;
+		return nano_exec_commands(args.command_arg);
+	}
+
 	/*******************************************************************************************************************
 	 * File option: -f {file_directory/name}
 	 * ---------------------------------------------------------------------------------------------------------------
 	 *  @brief If nanoShell is started with option -f it opens the given file to read every line and execute possible
 	 * 		commands from the file.
 	 * 		If the line starts with #, [LINE FEED], [SPACE] or [HORIZONTAL TAB] it is ignored.
-	 * 		nanoShell is terminated after reading all the lines.
+	 * 		With --jobs N the lines are run as a DAG on N workers, following the #@id NAME [after A,B] 
+	 * 		annotations, and the critical path is printed at the end.
+	 * 		With --journal FILE the number and exit status of the completed lines are written to FILE, and with
+	 * 		--resume the lines already completed with exit status 0 are skipped (if the script is the same).
+	 * 		With --watch nanoShell runs the file again each time it is written, executing only the lines changed
+	 * 		(and the ones declared after them). Otherwise nanoShell is terminated after reading all the lines.
 	 * 
 	 *******************************************************************************************************************/
 	if (args.file_given)
 	{
 		FILE *fileptr;
-		char *lineptr = NULL;
-		size_t n = 0;
-		ssize_t result;
 
 		fileptr = fopen(args.file_arg, "r");
 		if (fileptr == NULL)
@@ -637,86 +1449,114 @@ int main(int argc, char *argv[])
 			ERROR(NANO_ERROR_IO, "Error opening for reading!\n");
 		}
 
-		int i = 1;
 		printf("[INFO] Executing from file %s\n", args.file_arg);
 
-		while ((result = getline(&lineptr, &n, fileptr)) != -1)
+		if (args.resume_given && !args.journal_given)
+		{
+			printf("[ERROR] --resume needs --journal.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+		if (args.watch_given && args.journal_given)
+		{
+			printf("[ERROR] --watch can't be used with --journal.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+		if (args.journal_given)
 		{
-			//Verifies for #, [LINE FEED], [SPACE], [HORIZONTAL TAB] to ignore line
-			if (lineptr[0] != 35 && lineptr[0] != 10 && lineptr[0] != 32 && lineptr[0] != 9)
+			int res = nano_journal_open(args.journal_arg, args.file_arg, args.resume_given);
+
+			if (res == NANO_JOURNAL_ERROR_SCRIPT)
 			{
-				lineptr[strcspn(lineptr, "\n")] = 0;
-				printf("[command #%d]: %s\n", i, lineptr);
-				nano_exec_commands(lineptr);
-				i++;
+				printf("[ERROR] %s was changed since the journal %s was written, it can't be resumed.\n", 
+					   args.file_arg, args.journal_arg);
+				exit(C_EXIT_FAILURE);
+			}
+			else if (res != 0)
+			{
+				ERROR(NANO_ERROR_IO, "Error opening the journal %s\n", args.journal_arg);
 			}
 		}
 
-		free(lineptr);
-		fclose(fileptr);
-		return C_EXIT_SUCCESS;
-	}
+		if (args.jobs_given && args.jobs_arg <= 0)
+		{
+			printf("[ERROR] Invalid value \'int\' for --jobs.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+		if (args.watch_given)
+		{
+			fclose(fileptr);
+			nano_watch_run(args.file_arg, args.jobs_given ? (unsigned int)args.jobs_arg : 0, nano_exec_file);
+			ERROR(NANO_ERROR_IO, "Error watching %s for changes\n", args.file_arg);
+		}
 
-	/*************************************************************
-	 * SAVE TIMESTAMP FOR NANOSHELL STARTUP
-	 * 
-	 *************************************************************/
-	time_t starttime = time(NULL);
+		int res = nano_exec_file(fileptr, args.jobs_given ? (unsigned int)args.jobs_arg : 0);
 
-	if (starttime == -1)
-	{
-		printf("The time() function failed");
-		return 1;
+		fclose(fileptr);
+		return res;
 	}
 
-	ptm = localtime(&starttime);
-
-	if (ptm == NULL)
+	/*******************************************************************************************************************
+	 * Replay option: --replay {file} [--speed {double}]
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given nanoShell executes again the commands of a recording made with --record, with the
+	 * 		original time between them divided by --speed (default 1), or as fast as possible with --speed 0.
+	 * 		The achieved commands/sec is reported against the recording and nanoShell terminates.
+	 * 
+	 *******************************************************************************************************************/
+	if (args.replay_given)
 	{
-		printf("The localtime() function failed");
-		return 1;
+		if (args.speed_arg < 0)
+		{
+			printf("[ERROR] Invalid value \'double\' for --speed.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+		if (nano_replay(args.replay_arg, args.speed_arg, nano_exec_commands) == -1)
+		{
+			ERROR(NANO_ERROR_IO, "Error reading recording %s\n", args.replay_arg);
+		}
+		return C_EXIT_SUCCESS;
 	}
 
-	/*************************************************************
-	 * SIGNAL HANDLER
+	/*******************************************************************************************************************
+	 * Repeat option: --repeat {int} [--rate {R/s}] -- command
+	 * ---------------------------------------------------------------------------------------------------------------
+	 *  @brief If option is given nanoShell executes the command given after -- N times through the normal execution
+	 * 		path and prints the latency percentiles (HDR histogram), the throughput and the number of errors. 
+	 * 		With --rate the executions are scheduled at that rate (open-loop), otherwise one after the other.
+	 * 		nanoShell terminates with exit status 1 if any execution failed.
 	 * 
-	 *************************************************************/
-	struct sigaction act;
-
-	/* Defines routine to handle signals */
-	act.sa_sigaction = nano_sig_handler;
-
-	/* empty signals mask -- dont block signals */
-	sigemptyset(&act.sa_mask);
+	 *******************************************************************************************************************/
+	if (args.repeat_given)
+	{
+		double rate = 0;
 
-	act.sa_flags = SA_SIGINFO;	/*Additional info about signals */
-	act.sa_flags |= SA_RESTART; /*recovers from blocking calls*/
+		if (args.repeat_arg <= 0 || args.inputs_num == 0)
+		{
+			printf("[ERROR] Invalid value \'int\' for --repeat or missing command after --.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
+		if (args.rate_given && nano_parse_rate(args.rate_arg, &rate) == -1)
+		{
+			printf("[ERROR] Invalid value \'R/s\' for --rate.\n\n");
+			exit(C_ERROR_PARSING_ARGS);
+		}
 
-	/* Captures signal SIGUSR1 */
-	if (sigaction(SIGUSR1, &act, NULL) < 0)
-	{
-		ERROR(NANO_ERROR_SIGACTION, "sigaction - SIGUSR1");
-	}
-	/* Captures signal SIGUSR2 */
-	if (sigaction(SIGUSR2, &act, NULL) < 0)
-	{
-		ERROR(NANO_ERROR_SIGACTION, "sigaction - SIGUSR2");
-	} /* Captures signal SIGUSR1 */
-	if (sigaction(SIGINT, &act, NULL) < 0)
-	{
-		ERROR(NANO_ERROR_SIGACTION, "sigaction - SIGINT");
+		if (nano_loadgen(args.inputs, args.inputs_num, (unsigned int)args.repeat_arg, rate, nano_exec_commands) > 0)
+		{
+			return 1;
+		}
+		return C_EXIT_SUCCESS;
 	}
 
-
 	/*************************************************************
 	 * MAIN LOOP
 	 * 
 	 *************************************************************/
 	nano_loop();
 
-	if (args.max_arg && counters.G_max_commands > 0)
+	if (args.max_arg && counters->G_max_commands > 0)
 	{
-		printf("[INFO] nanoShell executed %d commands\n", counters.G_count_commands);
+		printf("[INFO] nanoShell executed %d commands\n", counters->G_count_commands);
 	}
 
 	return C_EXIT_SUCCESS;
@@ -0,0 +1,387 @@
+/**
+* @file memo.c
+* @brief Cache of the redirect outputs of earlier identical runs (--memo DIR)
+*
+* The key of a command is made of its arguments (with the NAME=value before them), the executable they resolve to
+* in PATH (path, device, inode, size and modification time, so an upgraded tool misses), its redirect and target,
+* the working directory, the value of the --memo-env variables and the contents of the input files declared with
+* "#@inputs A,B" before its line in a -f script. When a command with a redirect exits with status 0, what it 
+* wrote to the target is copied to DIR/{hash of the key}, after the key itself; an identical run later compares
+* the key (so a collision of the hash is a miss) and writes the copy to the target (or appends it, for >>) instead
+* of executing the command, like ccache. What the command writes to the terminal isn't kept.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "memo.h"
+#include "env.h"
+#include "stats.h"
+#include "nanoShell.h"
+
+#define NANO_MEMO_BUFSIZE 65536
+#define NANO_MEMO_DELIMITERS " \t,"
+
+int nano_memo_enabled = 0;
+
+static char *memo_dir;
+static char *memo_env;	  // Names of the variables in the key, separated by ,
+static char *memo_inputs; // Input files of the next command line
+
+/* Key of the command being looked up: length prefixed fields */
+static unsigned char *memo_key;
+static size_t memo_key_length;
+static size_t memo_key_capacity;
+
+/* Command looked up by nano_memo_lookup, waiting for nano_memo_store */
+static char memo_path[PATH_MAX];
+static char *memo_output;
+static int memo_redirect;
+static off_t memo_offset;
+static int memo_pending = 0;
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_add
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds the @param length bytes of @param data to the key, after its length, so "ab" "c" and 
+ * 		"a" "bc" are different keys.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_memo_add(const void *data, uint64_t length)
+{
+	if (memo_key_length + sizeof(length) + length > memo_key_capacity)
+	{
+		memo_key_capacity = (memo_key_length + sizeof(length) + length) * 2;
+		memo_key = REALLOC(memo_key, memo_key_capacity);
+		if (memo_key == NULL)
+		{
+			ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the memo key\n");
+		}
+	}
+	memcpy(&memo_key[memo_key_length], &length, sizeof(length));
+	memcpy(&memo_key[memo_key_length + sizeof(length)], data, length);
+	memo_key_length += sizeof(length) + length;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_field
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds the string @param str to the key.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_memo_field(const char *str)
+{
+	nano_memo_add(str, strlen(str));
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_add_file
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds the name and a hash and the size of the contents of the file @param path to the key. 
+ * 		A missing file is added only by its name, so creating it changes the key.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_memo_add_file(const char *path)
+{
+	static unsigned char buffer[NANO_MEMO_BUFSIZE];
+	uint64_t contents[2] = {NANO_FNV_OFFSET, 0}; // Hash and size
+	ssize_t length;
+	int fd;
+
+	nano_memo_field(path);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+	{
+		return;
+	}
+	while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+	{
+		contents[0] = nano_fnv1a(contents[0], buffer, (size_t)length);
+		contents[1] += (uint64_t)length;
+	}
+	close(fd);
+	nano_memo_add(contents, sizeof(contents));
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_add_executable
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds to the key the executable the command @param name resolves to in PATH, with its device,
+ * 		inode, size and modification time, so the output of an older version of it isn't restored.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_memo_add_executable(const char *name)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	nano_stats_resolve(name, path);
+	nano_memo_field(path);
+	if (stat(path, &st) == 0)
+	{
+		int64_t identity[6] = {(int64_t)st.st_dev, (int64_t)st.st_ino, (int64_t)st.st_size, 
+							   (int64_t)st.st_mtim.tv_sec, (int64_t)st.st_mtim.tv_nsec, 
+							   (int64_t)st.st_ctim.tv_sec};
+
+		nano_memo_add(identity, sizeof(identity));
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_key_matches
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the key at the start of the cache file @param fd and compares it with the key of the 
+ * 		command, leaving @param fd at the start of the output.
+ * 
+ * @return Function returns 1 if the keys are equal and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_memo_key_matches(int fd)
+{
+	uint64_t length;
+	unsigned char *key;
+	int res;
+
+	if (read(fd, &length, sizeof(length)) != sizeof(length) || length != memo_key_length)
+	{
+		return 0;
+	}
+	if ((key = MALLOC(length > 0 ? length : 1)) == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the memo key\n");
+	}
+	res = read(fd, key, length) == (ssize_t)length && memcmp(key, memo_key, length) == 0;
+	FREE(key);
+	return res;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_copy
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function copies the file descriptor @param from, from its current offset to the end, to @param to.
+ * 
+ * @return Function returns 0 if OK and -1 for an error reading or writing
+ *******************************************************************************************************************/
+static int nano_memo_copy(int from, int to)
+{
+	static char buffer[NANO_MEMO_BUFSIZE];
+	ssize_t length;
+
+	while ((length = read(from, buffer, sizeof(buffer))) > 0)
+	{
+		for (ssize_t done = 0, n; done < length; done += n)
+		{
+			if ((n = write(to, buffer + done, (size_t)(length - done))) == -1)
+			{
+				return -1;
+			}
+		}
+	}
+	return length == -1 ? -1 : 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function enables the cache in the directory @param dir (created if needed), with the variables of
+ * 		@param env_list (separated by , and may be NULL) in the keys.
+ * 
+ * @return Function returns 0 if OK and -1 if the directory can't be created
+ *******************************************************************************************************************/
+int nano_memo_open(const char *dir, const char *env_list)
+{
+	if (mkdir(dir, 0777) == -1 && errno != EEXIST)
+	{
+		return -1;
+	}
+	memo_dir = STRDUP(dir);
+	memo_env = env_list != NULL ? STRDUP(env_list) : NULL;
+	nano_memo_enabled = memo_dir != NULL;
+	return nano_memo_enabled ? 0 : -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_inputs
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function saves the input files @param list (the rest of a #@inputs annotation, separated by spaces or
+ * 		commas) for the keys of the next command line. NULL clears them.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_memo_inputs(const char *list)
+{
+	FREE(memo_inputs);
+	memo_inputs = list != NULL ? STRDUP(list) : NULL;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_lookup
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function computes the key of the command @param args, with the @param redirect (1 to 4, as returned by
+ * 		nano_verify_redirect) to @param outputfile. If the cache has an output for the key it is written to 
+ * 		@param outputfile. Otherwise the command is kept for nano_memo_store.
+ * 
+ * @return Function returns 1 if the output was restored from the cache and 0 if the command must be executed
+ *******************************************************************************************************************/
+int nano_memo_lookup(char **args, int redirect, const char *outputfile)
+{
+	char cwd[PATH_MAX];
+	uint64_t hash;
+	struct stat st;
+	int from, to;
+	int res;
+
+	memo_pending = 0;
+	if (!nano_memo_enabled || redirect < 1 || redirect > 4)
+	{
+		return 0;
+	}
+
+	memo_key_length = 0;
+	for (size_t i = 0; args[i] != NULL; i++)
+	{
+		nano_memo_field(args[i]);
+	}
+	nano_memo_add_executable(args[nano_env_assignments(args)]);
+	nano_memo_add(&redirect, sizeof(redirect));
+	nano_memo_field(outputfile);
+	if (getcwd(cwd, sizeof(cwd)) != NULL)
+	{
+		nano_memo_field(cwd);
+	}
+
+	/* strtok_r writes in the lists, so they are copied to the stack first */
+	if (memo_env != NULL)
+	{
+		char list[strlen(memo_env) + 1];
+		char *save;
+
+		strcpy(list, memo_env);
+		for (char *name = strtok_r(list, NANO_MEMO_DELIMITERS, &save); name != NULL; 
+			 name = strtok_r(NULL, NANO_MEMO_DELIMITERS, &save))
+		{
+			const char *value = getenv(name);
+			int set = value != NULL;
+
+			/* An unset variable is told apart from an empty one */
+			nano_memo_field(name);
+			nano_memo_field(set ? value : "");
+			nano_memo_add(&set, sizeof(set));
+		}
+	}
+	if (memo_inputs != NULL)
+	{
+		char list[strlen(memo_inputs) + 1];
+		char *save;
+
+		strcpy(list, memo_inputs);
+		for (char *path = strtok_r(list, NANO_MEMO_DELIMITERS, &save); path != NULL; 
+			 path = strtok_r(NULL, NANO_MEMO_DELIMITERS, &save))
+		{
+			nano_memo_add_file(path);
+		}
+	}
+
+	hash = nano_fnv1a(NANO_FNV_OFFSET, memo_key, memo_key_length);
+	snprintf(memo_path, sizeof(memo_path), "%s/%016llx", memo_dir, (unsigned long long)hash);
+
+	if ((from = open(memo_path, O_RDONLY | O_CLOEXEC)) != -1)
+	{
+		if (!nano_memo_key_matches(from))
+		{
+			DEBUG("memo collision in %s for %s", memo_path, args[0]);
+			close(from);
+		}
+		else
+		{
+			to = open(outputfile, O_WRONLY | O_CREAT | O_CLOEXEC | (redirect % 2 ? O_TRUNC : O_APPEND), 0666);
+			res = to != -1 && nano_memo_copy(from, to) == 0;
+			if (to != -1)
+			{
+				close(to);
+			}
+			close(from);
+			if (res)
+			{
+				DEBUG("memo hit %s for %s", memo_path, args[0]);
+				return 1;
+			}
+			WARNING("Error restoring %s from %s", outputfile, memo_path);
+		}
+	}
+
+	/* For >> only what the command appends is kept */
+	memo_offset = redirect % 2 == 0 && stat(outputfile, &st) == 0 ? st.st_size : 0;
+	FREE(memo_output);
+	memo_output = STRDUP(outputfile);
+	memo_redirect = redirect;
+	memo_pending = memo_output != NULL;
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_memo_store
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function copies to the cache, after its key, what the command looked up by nano_memo_lookup wrote to its
+ * 		redirect, if it exited with @param exit_status 0. The copy is written to a temporary file and renamed, so a
+ * 		concurrent lookup never sees half of it.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_memo_store(int exit_status)
+{
+	char tmp[PATH_MAX + 32];
+	uint64_t key_length = memo_key_length;
+	int from, to;
+	int res;
+
+	if (!memo_pending || exit_status != 0)
+	{
+		memo_pending = 0;
+		return;
+	}
+	memo_pending = 0;
+
+	if ((from = open(memo_output, O_RDONLY | O_CLOEXEC)) == -1)
+	{
+		return;
+	}
+	snprintf(tmp, sizeof(tmp), "%s.%d.tmp", memo_path, (int)getpid());
+	to = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	res = to != -1 && write(to, &key_length, sizeof(key_length)) == sizeof(key_length) &&
+		  write(to, memo_key, memo_key_length) == (ssize_t)memo_key_length &&
+		  lseek(from, memo_offset, SEEK_SET) != -1 && nano_memo_copy(from, to) == 0;
+	if (to != -1)
+	{
+		close(to);
+	}
+	close(from);
+
+	if (!res || rename(tmp, memo_path) == -1)
+	{
+		WARNING("Error saving %s (redirect %d) in %s", memo_output, memo_redirect, memo_path);
+		unlink(tmp);
+	}
+}
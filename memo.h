@@ -0,0 +1,18 @@
+/**
+* @file memo.h
+* @brief Cache of the redirect outputs of earlier identical runs (--memo DIR)
+*/
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#define NANO_MEMO_ANNOTATION "#@inputs"
+
+extern int nano_memo_enabled;
+
+int nano_memo_open(const char *dir, const char *env_list);
+void nano_memo_inputs(const char *list);
+int nano_memo_lookup(char **args, int redirect, const char *outputfile);
+void nano_memo_store(int exit_status);
+
+#endif /* MEMO_H */
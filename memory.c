@@ -4,13 +4,131 @@
  *
  * Macros to handle dynamic memory calls (malloc and free). The macros have
  * some error detection and report.
- * @version 2
+ *
+ * With eipa_mem_accounting() the number of allocations, the live bytes and
+ * the peak of live bytes are kept per call site (file and line of the 
+ * MALLOC/REALLOC/STRDUP) in a lock-free table. Each block then has a small
+ * header with its size and call site, so FREE knows what to discount.
+ *
+ * Every module of nanoShell allocates with these macros, apart from the
+ * buffers that libc allocates itself and the caller frees with free():
+ * the lines of getline() and the here-documents of open_memstream().
+ * nanoShell-logdecode isn't linked with this file and uses malloc.
+ * @version 3
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 
 #include "memory.h"
 
+/** Número de locais de alocação diferentes (potência de 2) */
+#define EIPA_MEM_SITES 1024
+
+/** Cabeçalho dos blocos quando a contabilização está ativa */
+struct EipaMemHeader {
+	size_t size;
+	size_t site;
+	max_align_t align[];
+};
+
+/** Estatísticas de um local de alocação */
+struct EipaMemSite {
+	_Atomic uint64_t key;		/**< (ficheiro << 16) | linha, 0 se livre */
+	const char *file;
+	int line;
+	_Atomic uint64_t allocs;
+	_Atomic uint64_t frees;
+	_Atomic uint64_t live;
+	_Atomic uint64_t peak;
+};
+
+static int accounting = 0;
+static atomic_int used = 0;
+static struct EipaMemSite sites[EIPA_MEM_SITES];
+
+/**
+ * Ativa a contabilização das alocações por local. Só pode ser ativada
+ * antes da primeira alocação feita com MALLOC/REALLOC.
+ *
+ * @return 0 se OK, -1 se já foram feitas alocações
+ */
+int eipa_mem_accounting(void) {
+	if (atomic_load(&used))
+		return -1;
+	accounting = 1;
+	return 0;
+}
+
+/**
+ * Indica se a contabilização das alocações está ativa.
+ *
+ * @return 1 se está ativa, 0 caso contrário
+ */
+int eipa_mem_accounting_enabled(void) {
+	return accounting;
+}
+
+/**
+ * Procura (ou ocupa) a entrada do local file:line na tabela, sem locks:
+ * uma entrada livre é ocupada com compare-and-swap da chave.
+ *
+ * @return O índice da entrada ou EIPA_MEM_SITES se a tabela está cheia
+ */
+static size_t eipa_mem_site(const int line, const char *file) {
+	uint64_t key = ((uint64_t)(uintptr_t)file << 16) | (uint64_t)(line & 0xffff);
+	size_t slot = (size_t)((key ^ (key >> 17)) * 0x9E3779B97F4A7C15ULL >> 54) & (EIPA_MEM_SITES - 1);
+
+	for (size_t n = 0; n < EIPA_MEM_SITES; n++, slot = (slot + 1) & (EIPA_MEM_SITES - 1)) {
+		uint64_t current = atomic_load(&sites[slot].key);
+
+		if (current == key)
+			return slot;
+		if (current == 0) {
+			if (atomic_compare_exchange_strong(&sites[slot].key, &current, key)) {
+				sites[slot].file = file;
+				sites[slot].line = line;
+				return slot;
+			}
+			if (current == key)
+				return slot;
+		}
+	}
+	return EIPA_MEM_SITES;
+}
+
+/**
+ * Contabiliza um bloco de size bytes alocado no local site.
+ */
+static void eipa_mem_count(struct EipaMemHeader *header, size_t size, size_t site) {
+	uint64_t live;
+	uint64_t peak;
+
+	header->size = size;
+	header->site = site;
+	if (site == EIPA_MEM_SITES)
+		return;
+
+	atomic_fetch_add(&sites[site].allocs, 1);
+	live = atomic_fetch_add(&sites[site].live, size) + size;
+	peak = atomic_load(&sites[site].peak);
+	while (live > peak && !atomic_compare_exchange_weak(&sites[site].peak, &peak, live))
+		;
+}
+
+/**
+ * Desconta um bloco libertado (ou realocado) do seu local.
+ */
+static void eipa_mem_discount(const struct EipaMemHeader *header) {
+	if (header->site == EIPA_MEM_SITES)
+		return;
+	atomic_fetch_add(&sites[header->site].frees, 1);
+	atomic_fetch_sub(&sites[header->site].live, header->size);
+}
+
 /**
  * Esta função deve ser utilizada para auxiliar a alocação de memória.
  * Esta função <b>não deve</b> ser chamada directamente, mas sim através
@@ -24,7 +142,18 @@
  * @see MALLOC
  */
 void *eipa_malloc(size_t size, const int line, const char *file) {
-	void *ptr = malloc(size);
+	void *ptr;
+
+	atomic_store(&used, 1);
+	if (accounting) {
+		struct EipaMemHeader *header = malloc(sizeof(struct EipaMemHeader) + size);
+		ptr = header != NULL ? header + 1 : NULL;
+		if (header != NULL)
+			eipa_mem_count(header, size, eipa_mem_site(line, file));
+	} else {
+		ptr = malloc(size);
+	}
+
 	if( ptr == NULL ) {
 		fprintf(stderr, "[%d@%s][ERROR] can't malloc %zu bytes\n",
 			       	line, file, size);
@@ -32,6 +161,69 @@ void *eipa_malloc(size_t size, const int line, const char *file) {
 	return ptr;
 }
 
+/**
+ * Esta função deve ser utilizada para mudar o tamanho de um bloco de 
+ * memória. Esta função <b>não deve</b> ser chamada directamente, mas sim
+ * através da macro REALLOC(). Com a contabilização ativa o bloco passa
+ * a pertencer ao local do REALLOC.
+ * @param ptr bloco a realocar (ou NULL)
+ * @param size novo tamanho do bloco
+ * @param file nome do ficheiro
+ * 	       (através da macro REALLOC)
+ * @param line linha onde a função foi chamada
+ * 	       (através da macro REALLOC)
+ * @return O novo bloco de memória ou NULL (o bloco original mantém-se)
+ * @see REALLOC
+ */
+void *eipa_realloc(void *ptr, size_t size, const int line, const char *file) {
+	void *new_ptr;
+
+	atomic_store(&used, 1);
+	if (accounting) {
+		struct EipaMemHeader *header = ptr != NULL ? (struct EipaMemHeader *)ptr - 1 : NULL;
+		struct EipaMemHeader old = {0, EIPA_MEM_SITES};
+
+		if (header != NULL)
+			old = *header;
+		header = realloc(header, sizeof(struct EipaMemHeader) + size);
+		new_ptr = header != NULL ? header + 1 : NULL;
+		if (header != NULL) {
+			if (ptr != NULL)
+				eipa_mem_discount(&old);
+			eipa_mem_count(header, size, eipa_mem_site(line, file));
+		}
+	} else {
+		new_ptr = realloc(ptr, size);
+	}
+
+	if( new_ptr == NULL ) {
+		fprintf(stderr, "[%d@%s][ERROR] can't realloc %zu bytes\n",
+			       	line, file, size);
+	}
+	return new_ptr;
+}
+
+/**
+ * Esta função deve ser utilizada para duplicar uma string. Esta função
+ * <b>não deve</b> ser chamada directamente, mas sim através da macro
+ * STRDUP(). A cópia é contabilizada no local do STRDUP.
+ * @param str string a duplicar
+ * @param file nome do ficheiro
+ * 	       (através da macro STRDUP)
+ * @param line linha onde a função foi chamada
+ * 	       (através da macro STRDUP)
+ * @return A cópia da string ou NULL em caso de erro
+ * @see STRDUP
+ */
+char *eipa_strdup(const char *str, const int line, const char *file) {
+	size_t size = strlen(str) + 1;
+	char *copy = eipa_malloc(size, line, file);
+
+	if (copy != NULL)
+		memcpy(copy, str, size);
+	return copy;
+}
+
 /**
  * Esta função deve ser utilizada para auxiliar a libertação de memória.
  * Esta função <b>não deve</b> ser chamada directamente, mas sim através
@@ -47,10 +239,53 @@ void *eipa_malloc(size_t size, const int line, const char *file) {
 void eipa_free(void **ptr, const int line, const char *file) {
 	(void)line;
 	(void)file;
-	free(*ptr);
+	if (accounting && *ptr != NULL) {
+		struct EipaMemHeader *header = (struct EipaMemHeader *)*ptr - 1;
+		eipa_mem_discount(header);
+		free(header);
+	} else {
+		free(*ptr);
+	}
 	*ptr = NULL;
 }
 
+/**
+ * Escreve em fileptr as estatísticas de cada local de alocação
+ * (alocações, libertações, bytes vivos e pico de bytes vivos) e os
+ * totais. Os valores são lidos sem locks, enquanto podem mudar.
+ * @param fileptr ficheiro onde escrever
+ * @return A função não retorna nada
+ */
+void eipa_mem_dump(FILE *fileptr) {
+	uint64_t allocs = 0;
+	uint64_t frees = 0;
+	uint64_t live = 0;
+
+	if (!accounting) {
+		fprintf(fileptr, "allocation statistics disabled (use --memstats)\n");
+		return;
+	}
+
+	fprintf(fileptr, "%-24s %12s %12s %12s %12s\n", "call site", "allocs", "frees", "live bytes", "peak bytes");
+	for (size_t i = 0; i < EIPA_MEM_SITES; i++) {
+		char site[64];
+
+		if (atomic_load(&sites[i].key) == 0 || sites[i].file == NULL)
+			continue;
+		snprintf(site, sizeof(site), "%s:%d", sites[i].file, sites[i].line);
+		fprintf(fileptr, "%-24s %12llu %12llu %12llu %12llu\n", site,
+			(unsigned long long)atomic_load(&sites[i].allocs),
+			(unsigned long long)atomic_load(&sites[i].frees),
+			(unsigned long long)atomic_load(&sites[i].live),
+			(unsigned long long)atomic_load(&sites[i].peak));
+		allocs += atomic_load(&sites[i].allocs);
+		frees += atomic_load(&sites[i].frees);
+		live += atomic_load(&sites[i].live);
+	}
+	fprintf(fileptr, "%-24s %12llu %12llu %12llu\n", "total", (unsigned long long)allocs,
+		(unsigned long long)frees, (unsigned long long)live);
+}
+
 void *swap_bytes(void *source, void *dest, size_t num_bytes) {
     unsigned char *source_p = (unsigned char*)source;
     unsigned char *dest_p = (unsigned char*)dest;
@@ -4,15 +4,21 @@
  *
  * Macros que a serem empregues nas aplicações que requerem o uso das
  * funções malloc e free
- * @version 1
+ * @version 2
  */
 #ifndef _MEMORY_H_
 #define _MEMORY_H_
 
+#include <stdio.h>
 #include <stdlib.h>
 
 void *eipa_malloc(size_t size, const int line, const char *file);
+void *eipa_realloc(void *ptr, size_t size, const int line, const char *file);
+char *eipa_strdup(const char *str, const int line, const char *file);
 void eipa_free(void **ptr, const int line, const char *file);
+int eipa_mem_accounting(void);
+int eipa_mem_accounting_enabled(void);
+void eipa_mem_dump(FILE *fileptr);
 void *swap_bytes(void *source, void *dest, size_t num_bytes);
 
 /**
@@ -22,6 +28,21 @@ void *swap_bytes(void *source, void *dest, size_t num_bytes);
  */
 #define MALLOC(size) eipa_malloc((size), __LINE__, __FILE__)
 
+/**
+ * Macro para mudar o tamanho de um bloco de memória.
+ *
+ * @return retorna o novo bloco de memória (NULL em caso de erro, 
+ * mantendo o bloco original)
+ */
+#define REALLOC(ptr, size) eipa_realloc((ptr), (size), __LINE__, __FILE__)
+
+/**
+ * Macro para duplicar uma string. A cópia é libertada com FREE.
+ *
+ * @return retorna a cópia (NULL em caso de erro)
+ */
+#define STRDUP(str) eipa_strdup((str), __LINE__, __FILE__)
+
 /**
  * Macro para libertar memória. Coloca o ponteiro a NULL.
  *
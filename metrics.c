@@ -0,0 +1,339 @@
+/**
+* @file metrics.c
+* @brief Prometheus metrics of the counters served on a Unix socket (--metrics-socket)
+*
+* nanoShell blocks in getline and waitpid, so the listener isn't served by the shell itself: a server process 
+* forked at startup runs a poll loop over the non-blocking listener and its clients, and renders the counters 
+* straight from the shared memory where the shell (and the workers of --jobs) update them. A scrape is a read of
+* the request, a few snprintf and one write, without signals nor files, and never delays a command.
+*
+* The request is answered when its headers end (or the client shuts down its side): with an HTTP/1.0 response
+* if it is a GET (curl --unix-socket, or a proxy for Prometheus), otherwise with just the metrics (socat).
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "metrics.h"
+#include "memo.h"
+#include "nanoShell.h"
+
+#define NANO_METRICS_CLIENTS 64		  // Clients served at once
+#define NANO_METRICS_BUFSIZE 8192	  // Request and response of a client
+#define NANO_METRICS_TIMEOUT_NS 5000000000ULL // Clients not done by then are dropped
+
+int nano_metrics_enabled = 0;
+
+static char metrics_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static pid_t metrics_owner; // Children inherit the atexit handler
+static pid_t metrics_server;
+
+/* A connection of the server: reading the request, then writing the response */
+struct NanoMetricsClient {
+	int fd;
+	uint64_t since;
+	size_t length;	// Bytes of the request read, then of the response
+	size_t written; // Bytes of the response written, -1 while reading the request
+	char buffer[NANO_METRICS_BUFSIZE];
+};
+
+static struct NanoMetricsClient clients[NANO_METRICS_CLIENTS];
+
+
+/*******************************************************************************************************************
+ * Function nano_metrics_render
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the counters to @param buffer of @param size bytes in the Prometheus text exposition 
+ * 		format, after an HTTP header if @param http.
+ * 
+ * @return Function returns the length of the response
+ *******************************************************************************************************************/
+static size_t nano_metrics_render(char *buffer, size_t size, int http)
+{
+	char body[NANO_METRICS_BUFSIZE];
+	size_t length = 0;
+	uint64_t cumulative = 0;
+
+#define NANO_METRICS_PRINTF(...) \
+	length += (size_t)snprintf(body + length, length < sizeof(body) ? sizeof(body) - length : 0, __VA_ARGS__)
+
+	NANO_METRICS_PRINTF("# HELP nanoshell_commands_total Commands executed.\n"
+						"# TYPE nanoshell_commands_total counter\n"
+						"nanoshell_commands_total %u\n", counters->G_count_commands);
+	NANO_METRICS_PRINTF("# HELP nanoshell_redirects_total Commands with their output redirected to a file.\n"
+						"# TYPE nanoshell_redirects_total counter\n"
+						"nanoshell_redirects_total{stream=\"stdout\"} %u\n"
+						"nanoshell_redirects_total{stream=\"stderr\"} %u\n", 
+						counters->G_count_stdout, counters->G_count_stderr);
+	NANO_METRICS_PRINTF("# HELP nanoshell_command_failures_total Commands that exited with a status other than 0.\n"
+						"# TYPE nanoshell_command_failures_total counter\n"
+						"nanoshell_command_failures_total %u\n", counters->G_count_failures);
+	NANO_METRICS_PRINTF("# HELP nanoshell_children_in_flight Commands running.\n"
+						"# TYPE nanoshell_children_in_flight gauge\n"
+						"nanoshell_children_in_flight %d\n", counters->G_count_inflight);
+	if (nano_memo_enabled)
+	{
+		NANO_METRICS_PRINTF("# HELP nanoshell_memo_lookups_total Lookups of the --memo cache.\n"
+							"# TYPE nanoshell_memo_lookups_total counter\n"
+							"nanoshell_memo_lookups_total{result=\"hit\"} %u\n"
+							"nanoshell_memo_lookups_total{result=\"miss\"} %u\n", 
+							counters->G_count_memo_hits, counters->G_count_memo_misses);
+	}
+
+	NANO_METRICS_PRINTF("# HELP nanoshell_spawn_seconds Time from fork to exec of the commands.\n"
+						"# TYPE nanoshell_spawn_seconds histogram\n");
+	for (int b = 0; b < NANO_SPAWN_BUCKETS; b++)
+	{
+		cumulative += counters->G_spawn_buckets[b];
+		if (b < NANO_SPAWN_BUCKETS - 1)
+		{
+			NANO_METRICS_PRINTF("nanoshell_spawn_seconds_bucket{le=\"%g\"} %llu\n", 
+								(double)(NANO_SPAWN_BUCKET_NS << b) / 1e9, (unsigned long long)cumulative);
+		}
+		else
+		{
+			NANO_METRICS_PRINTF("nanoshell_spawn_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+		}
+	}
+	NANO_METRICS_PRINTF("nanoshell_spawn_seconds_sum %.9f\n"
+						"nanoshell_spawn_seconds_count %llu\n", 
+						(double)counters->G_spawn_sum_ns / 1e9, (unsigned long long)cumulative);
+
+#undef NANO_METRICS_PRINTF
+
+	if (length >= sizeof(body))
+	{
+		length = sizeof(body) - 1;
+	}
+	if (!http)
+	{
+		memcpy(buffer, body, length < size ? length : size);
+		return length < size ? length : size;
+	}
+
+	int header = snprintf(buffer, size, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+							"Content-Length: %zu\r\nConnection: close\r\n\r\n", length);
+
+	if (header < 0 || (size_t)header + length > size)
+	{
+		return 0;
+	}
+	memcpy(buffer + header, body, length);
+	return (size_t)header + length;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_metrics_client
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function advances the client @param client whose socket is ready with @param revents: reads its request
+ * 		and renders the response when the request ends, and writes as much of the response as it can.
+ * 
+ * @return Function returns 1 if the client is done and must be closed, otherwise 0
+ *******************************************************************************************************************/
+static int nano_metrics_client(struct NanoMetricsClient *client, short revents)
+{
+	if (client->written == (size_t)-1)
+	{
+		ssize_t n = read(client->fd, client->buffer + client->length, sizeof(client->buffer) - 1 - client->length);
+
+		if (n == -1)
+		{
+			return errno != EAGAIN && errno != EINTR;
+		}
+		client->length += (size_t)n;
+		client->buffer[client->length] = 0;
+
+		/* The request ends with an empty line, or when the client shuts down its side */
+		if (n > 0 && strstr(client->buffer, "\r\n\r\n") == NULL && strstr(client->buffer, "\n\n") == NULL &&
+			client->length < sizeof(client->buffer) - 1)
+		{
+			return 0;
+		}
+		client->length = nano_metrics_render(client->buffer, sizeof(client->buffer), 
+											 strncmp(client->buffer, "GET ", 4) == 0);
+		client->written = 0;
+	}
+	else if (!(revents & POLLOUT))
+	{
+		return (revents & (POLLERR | POLLHUP)) != 0;
+	}
+
+	while (client->written < client->length)
+	{
+		ssize_t n = write(client->fd, client->buffer + client->written, client->length - client->written);
+
+		if (n == -1)
+		{
+			return errno != EAGAIN && errno != EINTR;
+		}
+		client->written += (size_t)n;
+	}
+	return 1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_metrics_serve
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function runs the poll loop of the server on the listening socket @param listener, until nanoShell
+ * 		exits. 
+ * 
+ * @return Function doesn't return
+ *******************************************************************************************************************/
+static void nano_metrics_serve(int listener)
+{
+	struct pollfd fds[NANO_METRICS_CLIENTS + 1];
+	size_t count = 0;
+
+	/* The server ends with nanoShell, and the Ctrl+C of the terminal is for nanoShell */
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+	if (getppid() != metrics_owner)
+	{
+		_exit(0);
+	}
+	signal(SIGINT, SIG_IGN);
+	signal(SIGUSR1, SIG_DFL);
+	signal(SIGUSR2, SIG_DFL);
+	signal(SIGRTMIN, SIG_DFL);
+	signal(SIGPIPE, SIG_IGN);
+
+	while (1)
+	{
+		uint64_t now = nano_time_ns();
+
+		fds[0].fd = count < NANO_METRICS_CLIENTS ? listener : -1;
+		fds[0].events = POLLIN;
+		for (size_t i = 0; i < count; i++)
+		{
+			fds[i + 1].fd = clients[i].fd;
+			fds[i + 1].events = clients[i].written == (size_t)-1 ? POLLIN : POLLOUT;
+			fds[i + 1].revents = 0;
+		}
+		if (poll(fds, count + 1, 1000) == -1 && errno != EINTR)
+		{
+			_exit(1);
+		}
+
+		/* Advance the clients, and drop the ones done or too slow (keeping the array compact) */
+		for (size_t i = count; i-- > 0;)
+		{
+			int done = now - clients[i].since > NANO_METRICS_TIMEOUT_NS;
+
+			if (!done && fds[i + 1].revents != 0)
+			{
+				done = nano_metrics_client(&clients[i], fds[i + 1].revents);
+			}
+			if (done)
+			{
+				close(clients[i].fd);
+				clients[i] = clients[--count];
+				fds[i + 1] = fds[count + 1];
+			}
+		}
+
+		while (count < NANO_METRICS_CLIENTS && (fds[0].revents & POLLIN))
+		{
+			int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+			if (fd == -1)
+			{
+				break;
+			}
+			clients[count].fd = fd;
+			clients[count].since = now;
+			clients[count].length = 0;
+			clients[count].written = (size_t)-1;
+			count++;
+		}
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_metrics_close
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function stops the server and removes the socket. Registered with atexit, it does nothing in the 
+ * 		children that inherit the registration.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_metrics_close(void)
+{
+	if (getpid() != metrics_owner)
+	{
+		return;
+	}
+	kill(metrics_server, SIGTERM);
+	unlink(metrics_path);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_metrics_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function listens on the Unix socket @param path (replacing an old socket there) and forks the server
+ * 		of the metrics. 
+ * 
+ * @return Function returns 0 if OK or -1 if the socket can't be created
+ *******************************************************************************************************************/
+int nano_metrics_open(const char *path)
+{
+	struct sockaddr_un address = {.sun_family = AF_UNIX};
+	struct stat info;
+	int listener;
+
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	strcpy(metrics_path, path);
+
+	if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+	{
+		unlink(path);
+	}
+
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener == -1)
+	{
+		return -1;
+	}
+	if (bind(listener, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(listener, SOMAXCONN) == -1)
+	{
+		close(listener);
+		return -1;
+	}
+
+	metrics_owner = getpid();
+	fflush(stdout);
+	metrics_server = fork();
+	if (metrics_server == -1)
+	{
+		close(listener);
+		unlink(path);
+		return -1;
+	}
+	if (metrics_server == 0)
+	{
+		nano_metrics_serve(listener);
+	}
+
+	close(listener);
+	nano_metrics_enabled = 1;
+	atexit(nano_metrics_close);
+	return 0;
+}
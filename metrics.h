@@ -0,0 +1,13 @@
+/**
+* @file metrics.h
+* @brief Prometheus metrics of the counters served on a Unix socket (--metrics-socket)
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+extern int nano_metrics_enabled;
+
+int nano_metrics_open(const char *path);
+
+#endif /* METRICS_H */
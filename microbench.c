@@ -0,0 +1,237 @@
+/**
+* @file microbench.c
+* @brief Microbenchmark of the parser (make microbench): nano_verify_char, nano_split_lineptr and
+* 		nano_verify_redirect timed alone over corpora of realistic and adversarial lines, in ns/byte
+*
+* Each function runs over every line of a corpus until NANO_BENCH_BYTES bytes were processed, and the best of
+* NANO_BENCH_ROUNDS rounds is printed (the other ones are noise of the machine). nano_split_lineptr cuts the line,
+* so it runs over a copy, and the time of the copy is measured alone and subtracted. nano_verify_redirect cuts the
+* tokens, so it runs over a copy of the tokens split before the rounds (the copy is counted in its time).
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "counters.h"
+#include "parse.h"
+#include "nanoShell.h"
+
+#define NANO_BENCH_BYTES (16UL << 20) // Bytes of lines processed by each round
+#define NANO_BENCH_ROUNDS 3
+#define NANO_BENCH_LINE 65536		  // Length of the long lines (as NANO_BATCH_BUFSIZE, a full read)
+
+struct NanoCounters *counters; // Defined by main.c in nanoShell
+
+/* A corpus: lines as given to the parser, without the LINE FEED */
+struct NanoCorpus {
+	const char *name;
+	char **lines;
+	char ***tokens; // Tokens of each line, split over the copy in buffers
+	char **buffers;
+	size_t count;
+	size_t bytes;
+};
+
+/* What is measured over each line (COPY is the copy done before nano_split_lineptr, subtracted from it) */
+enum NanoBenchPhase {
+	NANO_BENCH_CHAR,
+	NANO_BENCH_COPY,
+	NANO_BENCH_SPLIT,
+	NANO_BENCH_REDIRECT
+};
+
+static const char *realistic[] = {
+	"ls -l /tmp",
+	"ps aux -l",
+	"gcc -Wall -Wextra -std=c11 -c main.c > build.log",
+	"make && ./app || echo failed",
+	"LC_ALL=C sort -u names.txt > sorted.txt",
+	"grep -rn nano_exec src 2> errors.txt",
+	"tar -czf backup.tgz /home/user/docs >> backup.log",
+	"cat access.log;wc -l access.log",
+	"find . -name main.c -newer makefile",
+	"date > now.txt && cat now.txt",
+	"cp -r build/ dist/ 2>> copy.err",
+	"sleep 1",
+};
+
+
+/*******************************************************************************************************************
+ * Function nano_bench_add
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds a copy of the line @param line to the corpus @param corpus, and its tokens.
+ *
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_bench_add(struct NanoCorpus *corpus, const char *line)
+{
+	corpus->lines = REALLOC(corpus->lines, (corpus->count + 1) * sizeof(char *));
+	corpus->buffers = REALLOC(corpus->buffers, (corpus->count + 1) * sizeof(char *));
+	corpus->tokens = REALLOC(corpus->tokens, (corpus->count + 1) * sizeof(char **));
+	corpus->lines[corpus->count] = strdup(line);
+	corpus->buffers[corpus->count] = strdup(line);
+	if (corpus->lines[corpus->count] == NULL || corpus->buffers[corpus->count] == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating memory for the corpus\n");
+	}
+	corpus->tokens[corpus->count] = nano_split_lineptr(corpus->buffers[corpus->count]);
+	corpus->bytes += strlen(line);
+	corpus->count++;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_bench_repeat
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds to @param corpus a line made of @param unit repeated up to NANO_BENCH_LINE bytes,
+ * 		followed by @param last (the last character of the line, or "").
+ *
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_bench_repeat(struct NanoCorpus *corpus, const char *unit, const char *last)
+{
+	size_t length = strlen(unit);
+	char *line = MALLOC(NANO_BENCH_LINE + strlen(last) + 1);
+	size_t used = 0;
+
+	while (used + length <= NANO_BENCH_LINE)
+	{
+		memcpy(&line[used], unit, length);
+		used += length;
+	}
+	strcpy(&line[used], last);
+	nano_bench_add(corpus, line);
+	FREE(line);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_bench_run
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function runs the @param phase over the lines of @param corpus until NANO_BENCH_BYTES bytes were
+ * 		processed, NANO_BENCH_ROUNDS times.
+ *
+ * @return Function returns the best time of a round in ns per byte
+ *******************************************************************************************************************/
+static double nano_bench_run(const struct NanoCorpus *corpus, enum NanoBenchPhase phase)
+{
+	char *work = MALLOC(NANO_BENCH_LINE + 64);
+	char **tokens;
+	char **copy = MALLOC((NANO_BENCH_LINE + 2) * sizeof(char *));
+	size_t n_tokens;
+	double best = 0;
+	volatile int sink = 0; // The result of nano_verify_char must be used
+
+	for (int round = 0; round < NANO_BENCH_ROUNDS; round++)
+	{
+		size_t bytes = 0;
+		uint64_t start = nano_time_ns();
+		double ns;
+
+		while (bytes < NANO_BENCH_BYTES)
+		{
+			for (size_t i = 0; i < corpus->count; i++)
+			{
+				const char *line = corpus->lines[i];
+				size_t length = strlen(line);
+
+				switch (phase)
+				{
+				case NANO_BENCH_CHAR:
+					sink += nano_verify_char((char *)line);
+					break;
+				case NANO_BENCH_COPY:
+					memcpy(work, line, length + 1);
+					sink += work[0];
+					break;
+				case NANO_BENCH_SPLIT:
+					memcpy(work, line, length + 1);
+					tokens = nano_split_lineptr(work);
+					FREE(tokens);
+					break;
+				case NANO_BENCH_REDIRECT:
+				{
+					char *outputfile = NULL;
+
+					for (n_tokens = 0; corpus->tokens[i][n_tokens] != NULL; n_tokens++)
+						;
+					memcpy(copy, corpus->tokens[i], (n_tokens + 1) * sizeof(char *));
+					sink += nano_verify_redirect(copy, &outputfile);
+					break;
+				}
+				}
+				bytes += length;
+			}
+		}
+
+		ns = (double)(nano_time_ns() - start) / (double)bytes;
+		best = round == 0 || ns < best ? ns : best;
+	}
+
+	FREE(copy);
+	FREE(work);
+	return best;
+}
+
+
+/*******************************************************************************************************************
+ * Function main
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function builds the corpora and prints the ns/byte of each function over each of them.
+ *
+ * @return Function returns 0
+ *******************************************************************************************************************/
+int main(void)
+{
+	struct NanoCorpus corpora[7] = {
+		{.name = "realistic"},
+		{.name = "long token"},
+		{.name = "many tokens"},
+		{.name = "many redirects"},
+		{.name = "many operators"},
+		{.name = "rejected at end"},
+		{.name = "leading spaces"},
+	};
+	size_t n_corpora = sizeof(corpora) / sizeof(corpora[0]);
+
+	counters = nano_counters_open();
+
+	for (size_t i = 0; i < sizeof(realistic) / sizeof(realistic[0]); i++)
+	{
+		nano_bench_add(&corpora[0], realistic[i]);
+	}
+	nano_bench_repeat(&corpora[1], "abcdefghijklmnopqrstuvwxyz0123456789/._-", "");
+	nano_bench_repeat(&corpora[2], "a ", "");
+	nano_bench_repeat(&corpora[3], "cmd > out ", "");
+	nano_bench_repeat(&corpora[4], "a&&b||c;", "");
+	nano_bench_repeat(&corpora[5], "ls -l /tmp ", "$");
+	nano_bench_repeat(&corpora[6], " ", "ls");
+
+	printf("%-16s %10s %8s %14s %14s %14s\n", "corpus", "lines", "B/line", "verify_char", "split_lineptr",
+		   "verify_redir");
+	for (size_t i = 0; i < n_corpora; i++)
+	{
+		double copy = nano_bench_run(&corpora[i], NANO_BENCH_COPY);
+		double split = nano_bench_run(&corpora[i], NANO_BENCH_SPLIT) - copy;
+
+		printf("%-16s %10zu %8zu %9.3f ns/B %9.3f ns/B %9.3f ns/B\n", corpora[i].name, corpora[i].count,
+			   corpora[i].bytes / corpora[i].count, nano_bench_run(&corpora[i], NANO_BENCH_CHAR),
+			   split > 0 ? split : 0, nano_bench_run(&corpora[i], NANO_BENCH_REDIRECT));
+
+		for (size_t j = 0; j < corpora[i].count; j++)
+		{
+			free(corpora[i].lines[j]);
+			free(corpora[i].buffers[j]);
+			FREE(corpora[i].tokens[j]);
+		}
+		FREE(corpora[i].lines);
+		FREE(corpora[i].buffers);
+		FREE(corpora[i].tokens);
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+/**
+* @file nanoShell.h
+* @brief Exit codes, counters and helpers shared by the nanoShell modules
+*/
+
+#ifndef NANOSHELL_H
+#define NANOSHELL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * EXIT CODES
+ */
+#define C_EXIT_FAILURE -1
+#define C_EXIT_SUCCESS 0
+#define C_ERROR_PARSING_ARGS 1
+#define NANO_TIME_ERROR 2
+#define NANO_ERROR_MALLOC 3
+#define NANO_ERROR_READ 4
+#define NANO_ERROR_IO 5
+#define NANO_ERROR_FORK 6
+#define NANO_ERROR_EXECVP 7
+#define NANO_ERROR_SIGACTION 8
+#define NANO_MAX_INVALID 9
+
+/* Buckets of the spawn latency histogram (fork to exec): up to 25 us * 2^b, the last one without limit */
+#define NANO_SPAWN_BUCKETS 10
+#define NANO_SPAWN_BUCKET_NS 25000ULL
+
+/* Counters of the commands, in shared memory: the workers of --jobs count their own executions and the 
+ * --metrics-socket server reads them */
+struct NanoCounters {
+	_Atomic unsigned int G_count_stdout;
+	_Atomic unsigned int G_count_stderr;
+	unsigned int G_max_commands;
+	_Atomic unsigned int G_count_commands;
+	_Atomic unsigned int G_count_memo_hits;
+	_Atomic unsigned int G_count_memo_misses;
+	_Atomic unsigned int G_count_failures;		// Commands with exit status != 0
+	_Atomic int G_count_inflight;				// Children forked and not yet reaped
+	_Atomic uint64_t G_spawn_buckets[NANO_SPAWN_BUCKETS];
+	_Atomic uint64_t G_spawn_sum_ns;
+};
+
+extern struct NanoCounters *counters;
+
+/* FNV-1a 64 bits, for the keys of --memo and the script of --journal */
+#define NANO_FNV_OFFSET 14695981039346656037ULL
+#define NANO_FNV_PRIME 1099511628211ULL
+
+/*******************************************************************************************************************
+ * Function nano_time_ns
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the monotonic clock, used to measure the phases of the commands.
+ * 
+ * @return Function returns the current monotonic time in nanoseconds
+ *******************************************************************************************************************/
+static inline uint64_t nano_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************************************************
+ * Function nano_fnv1a
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds @param size bytes of @param data to the FNV-1a hash @param hash, which starts with 
+ * 		NANO_FNV_OFFSET.
+ * 
+ * @return Function returns the new hash
+ *******************************************************************************************************************/
+static inline uint64_t nano_fnv1a(uint64_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * NANO_FNV_PRIME;
+	}
+	return hash;
+}
+
+/*******************************************************************************************************************
+ * Function nano_spawn_bucket
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function finds the bucket of the spawn latency histogram for @param ns.
+ * 
+ * @return Function returns the first bucket whose limit isn't below @param ns
+ *******************************************************************************************************************/
+static inline int nano_spawn_bucket(uint64_t ns)
+{
+	int bucket = 0;
+
+	while (bucket < NANO_SPAWN_BUCKETS - 1 && ns > NANO_SPAWN_BUCKET_NS << bucket)
+	{
+		bucket++;
+	}
+	return bucket;
+}
+
+#endif /* NANOSHELL_H */
@@ -0,0 +1,271 @@
+/**
+* @file parse.c
+* @brief Validation and splitting of the command lines: the parser that runs for every command
+*
+* Kept apart from main.c so the microbenchmark (make microbench) and the fuzz target (make fuzz) can link it
+* without the rest of nanoShell.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "counters.h"
+#include "parse.h"
+#include "nanoShell.h"
+
+/*******************************************************************************************************************
+ * Function nano_verify_char
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function receives @param lineptr with the inserted command to verify if it was inserted any character
+ *  	that isn't supported. First verifies if there is a TAB, SPACE or % in the first char( @param lineptr[0] ), after 
+ *  	validates there isn't any of those it verifies the unsupported characters in the whole @param lineptr.
+ * 		& and | are only accepted in pairs, as the && and || list operators.
+ * 
+ * 	Unsupported characters: !, ", #, $, ', (, ), , , :, ?, @, [, \, ], ^, `, {, }, ~
+ * 
+ * @return Function returns @param result with 0 if all characters are OK and -1 if one unsupported character is found
+ *******************************************************************************************************************/
+int nano_verify_char(char *lineptr)
+{
+	int res = 0;
+	size_t length = strlen(lineptr);
+	size_t i;
+
+	int verify[] = {33, 34, 35, 36, 39, 40, 41, 42, 44, 58, 63, 64, 91, 92, 93, 94, 96, 123, 125 , 126};
+
+	size_t verlength = sizeof(verify) / sizeof(verify[0]);
+
+	/* Verify SPACE and TAB and % in first char */
+	if (lineptr[0] == 32 || lineptr[0] == 9 || lineptr[0] == 37)
+	{
+		return -1;
+	}
+
+	/* Verify other chars */
+	for (i = 0; i < length; i++)
+	{
+		/* & and | only as && and || */
+		if (lineptr[i] == 38 || lineptr[i] == 124)
+		{
+			if (lineptr[i + 1] != lineptr[i])
+			{
+				return -1;
+			}
+			i++;
+			continue;
+		}
+
+		for (size_t j = 0; j < verlength; j++)
+		{
+			if (lineptr[i] == verify[j])
+			{
+				res = -1;
+				j = verlength;
+				i = length;
+			}
+		}
+	}
+	return res;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_verify_pointer
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function receives the pointer @param ptr to verify if the memory was allocated correctly.
+ *  	If the memory wasn't well allocated it sends and ERROR with a message	
+ * 
+ * @return Functions returns void
+ *******************************************************************************************************************/
+void nano_verify_pointer(char **ptr)
+{
+	if (ptr == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_split_lineptr
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function to parse and split the given string @param lineptr and split in different tokens separated by SPACE, 
+ * 		adding them to @param tokens and terminate each token with NULL. The list operators ;, && and || are always
+ * 		tokens of their own, even when they are not surrounded by SPACE (ex: ls;pwd). The last position of 
+ * 		@param tokens is also set to NULL so it can be later used in EXECVP.
+ * 
+ * @return Function returns a pointer to @param tokens with the necessary arguments for the EXECVP.
+ *******************************************************************************************************************/
+char **nano_split_lineptr(char *lineptr)
+{
+
+	char *token;
+	const char *op;
+	int buffersize = NANO_TOKENS_BUFSIZE;
+	char **tokens = MALLOC(buffersize * sizeof(char *));
+
+	int pos = 0;
+
+	nano_verify_pointer(tokens);
+
+	while (*lineptr != 0)
+	{
+		if (*lineptr == ' ')
+		{
+			*lineptr++ = 0;
+			continue;
+		}
+
+		if ((op = nano_list_operator(lineptr)) != NULL)
+		{
+			/* Operators are kept as static strings so the previous token can end here */
+			token = (char *)op;
+			*lineptr = 0;
+			lineptr += strlen(op);
+		}
+		else
+		{
+			token = lineptr;
+			while (*lineptr != 0 && *lineptr != ' ' && nano_list_operator(lineptr) == NULL)
+			{
+				lineptr++;
+			}
+		}
+
+		tokens[pos] = token;
+		pos++;
+
+		if (pos >= buffersize)
+		{
+			buffersize = buffersize + NANO_TOKENS_BUFSIZE;
+			tokens = REALLOC(tokens, buffersize * sizeof(char *));
+
+			nano_verify_pointer(tokens);
+		}
+	}
+
+	tokens[pos] = NULL;
+
+	return tokens;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_list_operator
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies if the string @param str starts with one of the list operators ;, && or ||.
+ * 
+ * @return Function returns the static string of the operator found or NULL if @param str doesn't start with one
+ *******************************************************************************************************************/
+const char *nano_list_operator(const char *str)
+{
+	if (str[0] == ';')
+	{
+		return ";";
+	}
+	if (str[0] == '&' && str[1] == '&')
+	{
+		return "&&";
+	}
+	if (str[0] == '|' && str[1] == '|')
+	{
+		return "||";
+	}
+	return NULL;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_verify_redirect
+ * ----------------------------------------------------------------------------------------------------------------
+ * @brief Function receives @param args with the inserted command and verifies
+ * 	if the command is a redirect command, saving the redirect destination to
+ * 	@param outputfile. Then counters for the total executed commands, stdout 
+ * redirect commands and stderr redirect commands are also incremented here.
+ * 
+ * @return Function returns an Int depending on the redirect:
+ * 
+ * 				-1 if it isn't a redirect command
+ * 				 1 if it is a stdout redirect to new or clean file
+ * 				 2 if it is a stdout redirect to append in file
+ * 				 3 if it is a stderr redirect to new or clean file
+ * 				 4 if it is a stderr redirect to append in file
+ * 				 5 if it is a compressed stdout redirect to new or clean file (>z)
+ * 				 6 if it is a compressed stdout redirect to append in file (>>z)
+ * 
+ *******************************************************************************************************************/
+int nano_verify_redirect(char **args, char **outputfile)
+{
+
+	for (int i = 0; args[i] != NULL; i++)
+	{
+		if ((strcmp(args[i], ">") == 0))
+		{
+			*outputfile = args[i + 1];
+
+			args[i] = NULL;
+
+			//Increment STDOUT redir counter and Total commands executed
+			counters->G_count_stdout++;
+			counters->G_count_commands++;
+
+			return 1;
+		}
+		if ((strcmp(args[i], ">>") == 0))
+		{
+			*outputfile = args[i + 1];
+
+			args[i] = NULL;
+
+			//Increment STDOUT redir counter and Total commands executed
+			counters->G_count_stdout++;
+			counters->G_count_commands++;
+
+			return 2;
+		}
+		if ((strcmp(args[i], "2>") == 0))
+		{
+			*outputfile = args[i + 1];
+
+			args[i] = NULL;
+
+			//Increment STDERR redir counter and Total commands executed
+			counters->G_count_stderr++;
+			counters->G_count_commands++;
+
+			return 3;
+		}
+		if ((strcmp(args[i], "2>>") == 0))
+		{
+
+			*outputfile = args[i + 1];
+
+			args[i] = NULL;
+
+			//Increment STDERR redir counter and Total commands executed
+			counters->G_count_stderr++;
+			counters->G_count_commands++;
+
+			return 4;
+		}
+		if ((strcmp(args[i], ">z") == 0) || (strcmp(args[i], ">>z") == 0))
+		{
+			*outputfile = args[i + 1];
+
+			//Checked before the NULL
+			int append = args[i][1] == '>';
+			args[i] = NULL;
+
+			//Increment STDOUT redir counter and Total commands executed
+			counters->G_count_stdout++;
+			counters->G_count_commands++;
+
+			return append ? 6 : 5;
+		}
+	}
+	counters->G_count_commands++;
+	return -1;
+}
@@ -0,0 +1,17 @@
+/**
+* @file parse.h
+* @brief Validation and splitting of the command lines: the parser that runs for every command
+*/
+
+#ifndef PARSE_H
+#define PARSE_H
+
+#define NANO_TOKENS_BUFSIZE 32 //Size for tokes buffer
+
+int nano_verify_char(char *lineptr);
+void nano_verify_pointer(char **ptr);
+char **nano_split_lineptr(char *lineptr);
+const char *nano_list_operator(const char *str);
+int nano_verify_redirect(char **args, char **outputfile);
+
+#endif /* PARSE_H */
@@ -0,0 +1,216 @@
+/**
+* @file priority.c
+* @brief CPU (nice) and I/O (ionice) priority of the commands (--nice, --ionice, #@priority)
+*
+* The priority of a command line is the default of --nice and --ionice, or the one of a "#@priority NICE 
+* [CLASS[:LEVEL]]" line before it in a -f script, with CLASS rt, be or idle and LEVEL 0 (highest) to 7.
+* It is set by the child before exec. glibc has no wrapper for ioprio_set, so the system call is made directly.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "debug.h"
+#include "priority.h"
+#include "nanoShell.h"
+
+#define NANO_IOPRIO_WHO_PROCESS 1
+#define NANO_IOPRIO_CLASS_SHIFT 13
+#define NANO_IOPRIO_LEVELS 8
+
+int nano_priority_enabled = 0;
+
+static struct NanoPriority default_priority = {0, NANO_IOPRIO_NONE, 0};
+static struct NanoPriority current_priority = {0, NANO_IOPRIO_NONE, 0};
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_parse_io
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function parses the I/O priority @param str ("rt", "be" or "idle", with an optional ":LEVEL") into 
+ * 		@param prio.
+ * 
+ * @return Function returns 0 if OK and -1 if @param str isn't valid
+ *******************************************************************************************************************/
+static int nano_priority_parse_io(const char *str, struct NanoPriority *prio)
+{
+	static const char *classes[] = {NULL, "rt", "be", "idle"};
+	size_t length = strcspn(str, ":");
+
+	for (int class = NANO_IOPRIO_RT; class <= NANO_IOPRIO_IDLE; class++)
+	{
+		if (strlen(classes[class]) == length && strncmp(str, classes[class], length) == 0)
+		{
+			char *end;
+
+			prio->ioclass = class;
+			prio->iolevel = class == NANO_IOPRIO_IDLE ? 0 : NANO_IOPRIO_LEVELS / 2;
+			if (str[length] == ':')
+			{
+				prio->iolevel = (int)strtol(str + length + 1, &end, 10);
+				if (end == str + length + 1 || *end != 0 || prio->iolevel < 0 || prio->iolevel >= NANO_IOPRIO_LEVELS)
+				{
+					return -1;
+				}
+			}
+			return 0;
+		}
+	}
+	return -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_inherit
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function makes the niceness of nanoShell the default of the commands. It is called at startup, before
+ * 		any #@priority is parsed, so the lines before the first one inherit it too.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_priority_inherit(void)
+{
+	default_priority.nice = getpriority(PRIO_PROCESS, 0);
+	current_priority = default_priority;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_init
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function sets the default priority of the commands to the niceness @param nice (NANO_NICE_INHERIT to 
+ * 		keep the one of nanoShell) and the I/O priority @param ionice (NULL to keep the one of nanoShell).
+ * 
+ * @return Function returns 0 if OK and -1 if @param nice or @param ionice aren't valid
+ *******************************************************************************************************************/
+int nano_priority_init(int nice, const char *ionice)
+{
+	if (nice == NANO_NICE_INHERIT)
+	{
+		nice = getpriority(PRIO_PROCESS, 0);
+	}
+	if (nice < -20 || nice > 19 || (ionice != NULL && nano_priority_parse_io(ionice, &default_priority) == -1))
+	{
+		return -1;
+	}
+	default_priority.nice = nice;
+	current_priority = default_priority;
+	nano_priority_enabled = 1;
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_parse
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function parses the rest of a #@priority annotation @param str ("NICE [CLASS[:LEVEL]]") into 
+ * 		@param prio, starting from the default priority. The first annotation enables the priorities.
+ * 
+ * @return Function returns 0 if OK and -1 if @param str isn't valid
+ *******************************************************************************************************************/
+int nano_priority_parse(const char *str, struct NanoPriority *prio)
+{
+	char *end;
+	long nice = strtol(str, &end, 10);
+
+	*prio = default_priority;
+	if (end == str || nice < -20 || nice > 19)
+	{
+		return -1;
+	}
+	prio->nice = (int)nice;
+
+	end += strspn(end, " \t");
+	if (*end != 0 && nano_priority_parse_io(end, prio) == -1)
+	{
+		return -1;
+	}
+	nano_priority_enabled = 1;
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_compare
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function compares the urgency of @param a and @param b: by niceness, then by I/O class (a command
+ * 		without one is best-effort) and level.
+ * 
+ * @return Function returns < 0 if @param a is more urgent, > 0 if @param b is and 0 if they are the same
+ *******************************************************************************************************************/
+int nano_priority_compare(const struct NanoPriority *a, const struct NanoPriority *b)
+{
+	int class_a = a->ioclass == NANO_IOPRIO_NONE ? NANO_IOPRIO_BE : a->ioclass;
+	int class_b = b->ioclass == NANO_IOPRIO_NONE ? NANO_IOPRIO_BE : b->ioclass;
+
+	if (a->nice != b->nice)
+	{
+		return a->nice - b->nice;
+	}
+	if (class_a != class_b)
+	{
+		return class_a - class_b;
+	}
+	return a->iolevel - b->iolevel;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_default
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function copies the default priority to @param prio, for the lines without #@priority.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_priority_default(struct NanoPriority *prio)
+{
+	*prio = default_priority;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_set
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function sets the priority @param prio for the next command line. NULL goes back to the default.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_priority_set(const struct NanoPriority *prio)
+{
+	current_priority = prio != NULL ? *prio : default_priority;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_priority_apply
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function sets the priority of the current command line to the calling process (the child, before 
+ * 		exec). A failure (a negative niceness or the rt class without privileges) is only a warning.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_priority_apply(void)
+{
+	if (!nano_priority_enabled)
+	{
+		return;
+	}
+
+	if (setpriority(PRIO_PROCESS, 0, current_priority.nice) == -1)
+	{
+		WARNING("setpriority %d: %s", current_priority.nice, strerror(errno));
+	}
+	if (current_priority.ioclass != NANO_IOPRIO_NONE &&
+		syscall(SYS_ioprio_set, NANO_IOPRIO_WHO_PROCESS, 0,
+				current_priority.ioclass << NANO_IOPRIO_CLASS_SHIFT | current_priority.iolevel) == -1)
+	{
+		WARNING("ioprio_set %d:%d: %s", current_priority.ioclass, current_priority.iolevel, strerror(errno));
+	}
+}
@@ -0,0 +1,34 @@
+/**
+* @file priority.h
+* @brief CPU (nice) and I/O (ionice) priority of the commands (--nice, --ionice, #@priority)
+*/
+
+#ifndef PRIORITY_H
+#define PRIORITY_H
+
+#define NANO_PRIORITY_ANNOTATION "#@priority"
+#define NANO_NICE_INHERIT 20 // Out of the niceness range: the one of nanoShell
+
+/* I/O scheduling classes, as in ionice */
+#define NANO_IOPRIO_NONE 0
+#define NANO_IOPRIO_RT 1
+#define NANO_IOPRIO_BE 2
+#define NANO_IOPRIO_IDLE 3
+
+struct NanoPriority {
+	int nice;
+	int ioclass;
+	int iolevel;
+};
+
+extern int nano_priority_enabled;
+
+void nano_priority_inherit(void);
+int nano_priority_init(int nice, const char *ionice);
+int nano_priority_parse(const char *str, struct NanoPriority *prio);
+int nano_priority_compare(const struct NanoPriority *a, const struct NanoPriority *b);
+void nano_priority_default(struct NanoPriority *prio);
+void nano_priority_set(const struct NanoPriority *prio);
+void nano_priority_apply(void);
+
+#endif /* PRIORITY_H */
@@ -0,0 +1,25 @@
+/**
+* @file probes.c
+* @brief Semaphores of the USDT static tracepoints (see probes.h)
+*/
+
+#include "probes.h"
+
+#ifdef NANO_HAVE_SDT
+
+#define NANO_SEMAPHORE(name) \
+	unsigned short nanoShell_##name##_semaphore __attribute__((unused)) __attribute__((section(".probes")))
+
+NANO_SEMAPHORE(command_parsed);
+NANO_SEMAPHORE(child_forked);
+NANO_SEMAPHORE(redirect_opened);
+NANO_SEMAPHORE(exec_failed);
+NANO_SEMAPHORE(child_reaped);
+NANO_SEMAPHORE(signal_received);
+
+#else
+
+/* ISO C forbids an empty translation unit */
+typedef int nano_probes_unused;
+
+#endif /* NANO_HAVE_SDT */
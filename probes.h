@@ -0,0 +1,67 @@
+/**
+* @file probes.h
+* @brief USDT static tracepoints of the command lifecycle
+*
+* The probes use <sys/sdt.h> (systemtap-sdt-dev) when it is available at build time, and compile to nothing
+* otherwise. Each probe is a single nop until a tracer attaches, and the semaphore of each probe lets nanoShell
+* skip reading the clock for the latency arguments while nobody is listening. Ex:
+*
+*	bpftrace -e 'usdt:./nanoShell:nanoShell:child_reaped { @lat[str(arg1)] = hist(arg3); }'
+*
+* Probes and arguments:
+*	command_parsed	(shell pid, argv[0], redirect, ns since the line started to be validated)
+*	child_forked	(child pid, argv[0], redirect, ns spent in fork)
+*	redirect_opened	(child pid, argv[0], redirect, ns spent in freopen, output file)
+*	exec_failed	(child pid, argv[0], redirect, ns since fork, errno)
+*	child_reaped	(child pid, argv[0], redirect, ns since fork, exit status)
+*	signal_received	(sender pid, signal)
+* redirect is the value returned by nano_verify_redirect (-1 if there isn't a redirect).
+*/
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define NANO_HAVE_SDT 1
+#endif
+#endif
+
+#ifdef NANO_HAVE_SDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+/* Semaphores are incremented by the tracers when they attach to a probe (defined in probes.c) */
+extern unsigned short nanoShell_command_parsed_semaphore;
+extern unsigned short nanoShell_child_forked_semaphore;
+extern unsigned short nanoShell_redirect_opened_semaphore;
+extern unsigned short nanoShell_exec_failed_semaphore;
+extern unsigned short nanoShell_child_reaped_semaphore;
+extern unsigned short nanoShell_signal_received_semaphore;
+
+#define NANO_PROBE_ENABLED(name) __builtin_expect(nanoShell_##name##_semaphore, 0)
+#define NANO_PROBE2(name, a1, a2) STAP_PROBE2(nanoShell, name, a1, a2)
+#define NANO_PROBE4(name, a1, a2, a3, a4) STAP_PROBE4(nanoShell, name, a1, a2, a3, a4)
+#define NANO_PROBE5(name, a1, a2, a3, a4, a5) STAP_PROBE5(nanoShell, name, a1, a2, a3, a4, a5)
+
+#else
+
+/* The arguments are never evaluated, sizeof only keeps them "used" */
+#define NANO_PROBE_ENABLED(name) 0
+#define NANO_PROBE2(name, a1, a2) \
+	do { (void)sizeof(a1); (void)sizeof(a2); } while (0)
+#define NANO_PROBE4(name, a1, a2, a3, a4) \
+	do { NANO_PROBE2(name, a1, a2); NANO_PROBE2(name, a3, a4); } while (0)
+#define NANO_PROBE5(name, a1, a2, a3, a4, a5) \
+	do { NANO_PROBE4(name, a1, a2, a3, a4); (void)sizeof(a5); } while (0)
+
+#endif /* NANO_HAVE_SDT */
+
+/* Any probe of a command attached: the clock is only read for the latencies in that case */
+#define NANO_PROBES_ENABLED()                                                          \
+	(NANO_PROBE_ENABLED(command_parsed) || NANO_PROBE_ENABLED(child_forked) ||         \
+	 NANO_PROBE_ENABLED(redirect_opened) || NANO_PROBE_ENABLED(exec_failed) ||        \
+	 NANO_PROBE_ENABLED(child_reaped))
+
+#endif /* PROBES_H */
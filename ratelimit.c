@@ -0,0 +1,137 @@
+/**
+* @file ratelimit.c
+* @brief Token bucket rate limiting of the command launches (--rate, --burst)
+*
+* The bucket is kept as the theoretical arrival time (GCRA) in nanoseconds: each launch moves it 1/rate forward,
+* and a launch has to wait while it is more than (burst - 1)/rate in the future. This is a token bucket of
+* burst tokens refilled at rate tokens/sec, without floating point drift, and the wait is an absolute
+* clock_nanosleep to the exact time the next token is available. The state is shared with the forked workers.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "debug.h"
+#include "ratelimit.h"
+#include "nanoShell.h"
+
+/* The bucket is in a shared mapping, so the --jobs workers and the xargs -P workers take their tokens from the
+ * same bucket as nanoShell */
+struct NanoBucket {
+	uint64_t interval;				 // ns between tokens
+	uint64_t tolerance;				 // (burst - 1) * interval
+	_Atomic uint64_t tat;			 // theoretical arrival time of the next launch
+	/* Statistics for the status file */
+	_Atomic unsigned long throttled_launches;
+	_Atomic unsigned long total_launches;
+	_Atomic uint64_t throttled_ns;
+	_Atomic uint64_t max_throttled_ns;
+};
+
+int nano_ratelimit_enabled = 0;
+
+static struct NanoBucket *bucket;
+
+
+/*******************************************************************************************************************
+ * Function nano_ratelimit_init
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function enables the rate limit of @param rate launches/sec, with bursts of up to @param burst launches.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_ratelimit_init(double rate, unsigned int burst)
+{
+	bucket = mmap(NULL, sizeof(*bucket), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (bucket == MAP_FAILED)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error mapping the rate limit bucket\n");
+	}
+
+	/* At least 1 ns, the resolution of the clock, whatever the rate */
+	bucket->interval = rate < 1e9 ? (uint64_t)(1e9 / rate) : 1;
+	bucket->tolerance = (uint64_t)(burst > 0 ? burst - 1 : 0) * bucket->interval;
+	atomic_init(&bucket->tat, nano_time_ns());
+	nano_ratelimit_enabled = 1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_ratelimit_acquire
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function takes a token of the bucket before a launch, sleeping until one is available. The token is
+ * 		reserved with a CAS on the arrival time before sleeping, so concurrent workers wait in turn. The time 
+ * 		spent waiting is added to the throttle statistics.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_ratelimit_acquire(void)
+{
+	uint64_t now;
+	uint64_t tat;
+	uint64_t start;
+
+	if (!nano_ratelimit_enabled)
+	{
+		return;
+	}
+
+	now = nano_time_ns();
+	tat = atomic_load_explicit(&bucket->tat, memory_order_relaxed);
+	do
+	{
+		start = tat < now ? now : tat;
+	} while (!atomic_compare_exchange_weak_explicit(&bucket->tat, &tat, start + bucket->interval, 
+													memory_order_relaxed, memory_order_relaxed));
+
+	if (start - now > bucket->tolerance)
+	{
+		uint64_t until = start - bucket->tolerance;
+		uint64_t waited;
+		uint64_t max;
+		struct timespec ts = {(time_t)(until / 1000000000ULL), (long)(until % 1000000000ULL)};
+
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+			;
+
+		waited = nano_time_ns() - now;
+		atomic_fetch_add_explicit(&bucket->throttled_launches, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&bucket->throttled_ns, waited, memory_order_relaxed);
+		max = atomic_load_explicit(&bucket->max_throttled_ns, memory_order_relaxed);
+		while (waited > max && !atomic_compare_exchange_weak_explicit(&bucket->max_throttled_ns, &max, waited,
+																	  memory_order_relaxed, memory_order_relaxed))
+			;
+	}
+
+	atomic_fetch_add_explicit(&bucket->total_launches, 1, memory_order_relaxed);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_ratelimit_status
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the throttle statistics to the status file @param fileptr, so the time waiting for the
+ * 		rate limit can be told apart from slow commands.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_ratelimit_status(FILE *fileptr)
+{
+	uint64_t interval;
+
+	if (!nano_ratelimit_enabled)
+	{
+		return;
+	}
+
+	interval = bucket->interval > 0 ? bucket->interval : 1;
+
+	fprintf(fileptr, "%lu of %lu launch(es) throttled by --rate %.1f/s (burst %lu), %.3f s waiting (max %.3f ms)\n",
+			(unsigned long)bucket->throttled_launches, (unsigned long)bucket->total_launches, 
+			1e9 / (double)interval, (unsigned long)(bucket->tolerance / interval + 1), 
+			(double)bucket->throttled_ns / 1e9, (double)bucket->max_throttled_ns / 1e6);
+}
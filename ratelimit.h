@@ -0,0 +1,17 @@
+/**
+* @file ratelimit.h
+* @brief Token bucket rate limiting of the command launches (--rate, --burst)
+*/
+
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdio.h>
+
+extern int nano_ratelimit_enabled;
+
+void nano_ratelimit_init(double rate, unsigned int burst);
+void nano_ratelimit_acquire(void);
+void nano_ratelimit_status(FILE *fileptr);
+
+#endif /* RATELIMIT_H */
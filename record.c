@@ -0,0 +1,406 @@
+/**
+* @file record.c
+* @brief Session record (--record) and replay (--replay) of the executed commands
+*
+* Binary format of a recording (native byte order):
+*
+*	header:	"NSHREC1\n" (8 bytes), u64 start of the recording (ns since the epoch)
+*	record:	u64 offset of the launch since the start (ns), u32 duration (us), i16 exit status,
+*			i8 redirect (value of nano_verify_redirect), u8 unused, u16 length, command (length bytes)
+*
+* The records are written through a private buffer with write(2), so a child that exits before exec can't write
+* the buffer a second time, as it would with stdio. The workers of --jobs and xargs -P keep their own buffer
+* (nano_record_child) and append it when they exit, so the records aren't sorted by offset: --replay sorts them
+* before executing them, one after the other (launches that overlapped are serialized).
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "record.h"
+#include "nanoShell.h"
+
+#define NANO_RECORD_MAGIC "NSHREC1\n"
+#define NANO_RECORD_HEADER 18 // Size of the fixed part of a record
+#define NANO_RECORD_MAXLINE 65535
+#define NANO_RECORD_BUFSIZE 65536
+
+int nano_record_enabled = 0;
+
+static int record_fd = -1;
+static pid_t record_pid; // Process that owns the buffer: nanoShell or a worker
+static uint64_t record_origin;
+static unsigned char record_buffer[NANO_RECORD_BUFSIZE];
+static size_t record_used;
+
+/* Command being executed, saved by nano_record_start */
+static char pending_line[NANO_RECORD_MAXLINE + 1];
+static size_t pending_length;
+static uint64_t pending_start;
+
+
+/*******************************************************************************************************************
+ * Function nano_record_write
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the @param size bytes of @param buf to the recording file, retrying on short writes.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_record_write(const void *buf, size_t size)
+{
+	const unsigned char *ptr = buf;
+
+	while (size > 0)
+	{
+		ssize_t written = write(record_fd, ptr, size);
+		if (written == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			WARNING("write to recording");
+			return;
+		}
+		ptr += written;
+		size -= (size_t)written;
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_record_flush
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the buffered records to the recording file.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_record_flush(void)
+{
+	nano_record_write(record_buffer, record_used);
+	record_used = 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_record_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function creates the recording file @param path, writes the header and enables the recording.
+ * 		The file is closed by nano_record_close, registered with atexit.
+ * 
+ * @return Function returns 0 if OK and -1 if the file couldn't be created
+ *******************************************************************************************************************/
+int nano_record_open(const char *path)
+{
+	struct timespec now;
+	uint64_t epoch;
+
+	record_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if (record_fd == -1)
+	{
+		return -1;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	epoch = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+
+	/* The header is written now, before any worker can append its records */
+	memcpy(record_buffer, NANO_RECORD_MAGIC, 8);
+	memcpy(&record_buffer[8], &epoch, sizeof(epoch));
+	record_used = 16;
+	nano_record_flush();
+
+	record_origin = nano_time_ns();
+	record_pid = getpid();
+	nano_record_enabled = 1;
+	atexit(nano_record_close);
+
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_record_start
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function saves the command @param args that is going to be launched (joined with SPACE, so the redirect 
+ * 		is kept) and the launch time. It must be called before nano_verify_redirect cuts the redirect from 
+ * 		@param args.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_record_start(char **args)
+{
+	if (!nano_record_enabled)
+	{
+		return;
+	}
+
+	pending_length = 0;
+	for (size_t i = 0; args[i] != NULL; i++)
+	{
+		size_t length = strlen(args[i]);
+
+		if (pending_length + length + 1 > NANO_RECORD_MAXLINE)
+		{
+			break;
+		}
+		if (i > 0)
+		{
+			pending_line[pending_length++] = ' ';
+		}
+		memcpy(&pending_line[pending_length], args[i], length);
+		pending_length += length;
+	}
+
+	pending_start = nano_time_ns();
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_record_end
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function adds the record of the command saved by nano_record_start, with the @param redirect
+ * 		returned by nano_verify_redirect and its @param exit_status.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_record_end(int redirect, int exit_status)
+{
+	unsigned char *rec;
+	uint64_t offset;
+	uint32_t duration;
+	int16_t status16 = (int16_t)exit_status;
+	int8_t redirect8 = (int8_t)redirect;
+	uint16_t length = (uint16_t)pending_length;
+
+	if (!nano_record_enabled)
+	{
+		return;
+	}
+
+	if (record_used + NANO_RECORD_HEADER + pending_length > NANO_RECORD_BUFSIZE)
+	{
+		nano_record_flush();
+	}
+
+	offset = pending_start - record_origin;
+	duration = (uint32_t)((nano_time_ns() - pending_start) / 1000);
+
+	rec = &record_buffer[record_used];
+	memcpy(rec, &offset, 8);
+	memcpy(rec + 8, &duration, 4);
+	memcpy(rec + 12, &status16, 2);
+	memcpy(rec + 14, &redirect8, 1);
+	rec[15] = 0;
+	memcpy(rec + 16, &length, 2);
+	memcpy(rec + NANO_RECORD_HEADER, pending_line, pending_length);
+	record_used += NANO_RECORD_HEADER + pending_length;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_record_child
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function is called by a forked worker (--jobs, xargs -P): the records inherited from nanoShell are left
+ * 		to it, and the worker owns its buffer until nano_record_close appends it to the file.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_record_child(void)
+{
+	if (nano_record_enabled)
+	{
+		record_used = 0;
+		record_pid = getpid();
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_record_close
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes the remaining records and closes the recording (in a worker, its own records). It does 
+ * 		nothing in the other children, that inherit the atexit registration.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_record_close(void)
+{
+	if (!nano_record_enabled || getpid() != record_pid)
+	{
+		return;
+	}
+
+	nano_record_flush();
+	close(record_fd);
+	nano_record_enabled = 0;
+}
+
+
+/* A record of the recording, loaded for the replay */
+struct NanoReplayRecord {
+	uint64_t offset; // ns since the start of the recording
+	uint64_t end;	 // offset + duration (ns)
+	size_t index;	 // Position in the file, to keep the order of the records launched at the same offset
+	int16_t exit_status;
+	char *line;
+};
+
+
+/*******************************************************************************************************************
+ * Function nano_replay_compare
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function compares the records @param a and @param b by offset, for qsort (in the file order if equal).
+ * 
+ * @return Function returns < 0, 0 or > 0 as @param a is launched before, with or after @param b
+ *******************************************************************************************************************/
+static int nano_replay_compare(const void *a, const void *b)
+{
+	const struct NanoReplayRecord *ra = a;
+	const struct NanoReplayRecord *rb = b;
+
+	if (ra->offset != rb->offset)
+	{
+		return ra->offset < rb->offset ? -1 : 1;
+	}
+	return ra->index < rb->index ? -1 : ra->index > rb->index;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_replay_load
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the records of the recording @param fileptr (after its header) to @param records, 
+ * 		sorted by offset, as the workers of --jobs and xargs -P append theirs out of order.
+ * 
+ * @return Function returns the number of records
+ *******************************************************************************************************************/
+static size_t nano_replay_load(FILE *fileptr, struct NanoReplayRecord **records)
+{
+	unsigned char header[NANO_RECORD_HEADER];
+	size_t count = 0;
+	size_t capacity = 0;
+
+	*records = NULL;
+	while (fread(header, 1, NANO_RECORD_HEADER, fileptr) == NANO_RECORD_HEADER)
+	{
+		struct NanoReplayRecord *record;
+		uint32_t duration;
+		uint16_t length;
+
+		if (count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 256;
+			*records = REALLOC(*records, capacity * sizeof(struct NanoReplayRecord));
+			if (*records == NULL)
+			{
+				ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+			}
+		}
+		record = &(*records)[count];
+
+		memcpy(&record->offset, header, 8);
+		memcpy(&duration, header + 8, 4);
+		memcpy(&record->exit_status, header + 12, 2);
+		memcpy(&length, header + 16, 2);
+		record->end = record->offset + (uint64_t)duration * 1000;
+		record->index = count;
+
+		record->line = MALLOC((size_t)length + 1);
+		if (record->line == NULL)
+		{
+			ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+		}
+		if (fread(record->line, 1, length, fileptr) != length)
+		{
+			FREE(record->line);
+			break;
+		}
+		record->line[length] = 0;
+		count++;
+	}
+
+	if (count > 0)
+	{
+		qsort(*records, count, sizeof(struct NanoReplayRecord), nano_replay_compare);
+	}
+	return count;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_replay
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function executes again every command of the recording @param path with @param exec (the normal
+ * 		nano_exec_commands path), in the order of their offsets. With @param speed > 0 each command is launched 
+ * 		at its original offset divided by @param speed (1 is the original timing, 2 twice as fast), with 0 they 
+ * 		are launched as fast as possible. The replay is sequential: commands that overlapped in the recording
+ * 		(--jobs, xargs -P) can't overlap again, and one launched before the previous one ended starts late.
+ * 		At the end the achieved commands/sec is reported against the recording (from its start to the end of 
+ * 		the last command to end), with the number of commands whose exit status changed.
+ * 
+ * @return Function returns 0 if OK and -1 if the file couldn't be read or isn't a recording
+ *******************************************************************************************************************/
+int nano_replay(const char *path, double speed, int (*exec)(char *lineptr))
+{
+	FILE *fileptr;
+	unsigned char header[16];
+	struct NanoReplayRecord *records;
+	size_t count;
+	uint64_t start;
+	uint64_t last_end = 0;
+	unsigned int changed = 0;
+
+	fileptr = fopen(path, "r");
+	if (fileptr == NULL)
+	{
+		return -1;
+	}
+
+	if (fread(header, 1, 16, fileptr) != 16 || memcmp(header, NANO_RECORD_MAGIC, 8) != 0)
+	{
+		fclose(fileptr);
+		errno = EINVAL;
+		return -1;
+	}
+	count = nano_replay_load(fileptr, &records);
+	fclose(fileptr);
+
+	start = nano_time_ns();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (speed > 0)
+		{
+			uint64_t target = start + (uint64_t)((double)records[i].offset / speed);
+			struct timespec ts = {(time_t)(target / 1000000000ULL), (long)(target % 1000000000ULL)};
+
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+				;
+		}
+
+		if (exec(records[i].line) != records[i].exit_status)
+		{
+			changed++;
+		}
+
+		last_end = records[i].end > last_end ? records[i].end : last_end;
+		FREE(records[i].line);
+	}
+	FREE(records);
+
+	double recorded = (double)last_end / 1e9;
+	double replayed = (double)(nano_time_ns() - start) / 1e9;
+
+	printf("[INFO] Replayed %zu command(s) in %.3f s: %.1f commands/sec (recording: %.3f s, %.1f commands/sec)\n",
+		   count, replayed, replayed > 0 ? count / replayed : 0.0, recorded, recorded > 0 ? count / recorded : 0.0);
+	printf("[INFO] %u command(s) with a different exit status\n", changed);
+	return 0;
+}
@@ -0,0 +1,18 @@
+/**
+* @file record.h
+* @brief Session record (--record) and replay (--replay) of the executed commands
+*/
+
+#ifndef RECORD_H
+#define RECORD_H
+
+extern int nano_record_enabled;
+
+int nano_record_open(const char *path);
+void nano_record_start(char **args);
+void nano_record_end(int redirect, int exit_status);
+void nano_record_child(void);
+void nano_record_close(void);
+int nano_replay(const char *path, double speed, int (*exec)(char *lineptr));
+
+#endif /* RECORD_H */
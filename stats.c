@@ -0,0 +1,314 @@
+/**
+* @file stats.c
+* @brief Statistics of the commands per executable (stats builtin and SIGUSR2)
+*
+* The table is keyed by the executable the command name resolves to in PATH (as execvp does), so "ls" and
+* "/usr/bin/ls" are the same entry. Like the allocation sites of memory.c it has a fixed size and no locks: a free
+* entry is taken with a compare-and-swap of the key and the counters are atomic. It is in shared memory, so the
+* workers of --jobs count in it too.
+*
+* The latencies (from fork to the exit of the command) are kept in a log2 histogram of microseconds, enough for
+* the percentiles to be within a factor of 2.
+*
+* Resolving a name walks PATH with one access() per directory, and it is done for each command reaped (and by
+* --memo), so each process keeps the last NANO_STATS_RESOLVED names resolved, emptied when PATH changes. An 
+* executable installed later in a directory earlier in PATH isn't seen until then.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "debug.h"
+#include "stats.h"
+#include "nanoShell.h"
+
+#define NANO_STATS_ENTRIES 1024 // Size of the table (power of 2)
+#define NANO_STATS_BUCKETS 32	// Buckets of the histogram: [2^b, 2^(b+1)) microseconds
+#define NANO_STATS_RESOLVED 64	// Names kept resolved (power of 2)
+
+struct NanoStatsEntry {
+	_Atomic uint64_t key; // Hash of the path, 0 if free
+	char path[PATH_MAX];
+	_Atomic uint64_t calls;
+	_Atomic uint64_t failures;
+	_Atomic uint64_t total_ns;
+	_Atomic uint64_t max_ns;
+	_Atomic uint32_t buckets[NANO_STATS_BUCKETS];
+};
+
+/* A name resolved in PATH, in the cache of the process */
+struct NanoStatsResolved {
+	uint64_t key; // Hash of the name, 0 if free
+	char name[NAME_MAX + 1];
+	char path[PATH_MAX];
+};
+
+static struct NanoStatsEntry *entries;
+static struct NanoStatsResolved resolved[NANO_STATS_RESOLVED];
+static uint64_t resolved_env; // Hash of the PATH the names were resolved with
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_init
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function allocates the table in shared memory. Its pages are only used as the entries are taken.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_stats_init(void)
+{
+	entries = mmap(NULL, NANO_STATS_ENTRIES * sizeof(struct NanoStatsEntry), PROT_READ | PROT_WRITE,
+				   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (entries == MAP_FAILED)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating the statistics table\n");
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_resolve
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function resolves the command @param name to its executable in PATH, as execvp does, into @param path.
+ * 		A name with / or not found is kept as it is. The result is kept in the cache of the process while PATH
+ * 		doesn't change.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_stats_resolve(const char *name, char *path)
+{
+	const char *dirs = getenv("PATH");
+	size_t length = strlen(name);
+	struct NanoStatsResolved *cached;
+	uint64_t env;
+	uint64_t key;
+
+	snprintf(path, PATH_MAX, "%s", name);
+	if (strchr(name, '/') != NULL || dirs == NULL)
+	{
+		return;
+	}
+
+	env = nano_fnv1a(NANO_FNV_OFFSET, dirs, strlen(dirs));
+	if (env != resolved_env)
+	{
+		memset(resolved, 0, sizeof(resolved));
+		resolved_env = env;
+	}
+	key = nano_fnv1a(NANO_FNV_OFFSET, name, length) | 1;
+	cached = &resolved[key & (NANO_STATS_RESOLVED - 1)];
+	if (cached->key == key && strcmp(cached->name, name) == 0)
+	{
+		strcpy(path, cached->path);
+		return;
+	}
+
+	for (const char *dir = dirs; *dir != 0; dir += strcspn(dir, ":") + (dir[strcspn(dir, ":")] == ':'))
+	{
+		char candidate[PATH_MAX];
+		int dir_length = (int)strcspn(dir, ":");
+
+		snprintf(candidate, sizeof(candidate), "%.*s%s%s", dir_length, dir, dir_length > 0 ? "/" : "", name);
+		if (access(candidate, X_OK) == 0)
+		{
+			strcpy(path, candidate);
+			break;
+		}
+	}
+
+	if (length <= NAME_MAX)
+	{
+		cached->key = key;
+		strcpy(cached->name, name);
+		strcpy(cached->path, path);
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_entry
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function looks for (or takes) the entry of the executable @param path in the table, without locks.
+ * 
+ * @return Function returns the entry or NULL if the table is full
+ *******************************************************************************************************************/
+static struct NanoStatsEntry *nano_stats_entry(const char *path)
+{
+	uint64_t key = nano_fnv1a(NANO_FNV_OFFSET, path, strlen(path)) | 1;
+	size_t slot = (size_t)(key >> 32) & (NANO_STATS_ENTRIES - 1);
+
+	for (size_t n = 0; n < NANO_STATS_ENTRIES; n++, slot = (slot + 1) & (NANO_STATS_ENTRIES - 1))
+	{
+		uint64_t current = atomic_load(&entries[slot].key);
+
+		if (current == 0 && atomic_compare_exchange_strong(&entries[slot].key, &current, key))
+		{
+			snprintf(entries[slot].path, PATH_MAX, "%s", path);
+			return &entries[slot];
+		}
+		if (current == key)
+		{
+			return &entries[slot];
+		}
+	}
+	return NULL;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_record
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function counts a call of the command @param name that ended with @param exit_status after @param ns.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_stats_record(const char *name, int exit_status, uint64_t ns)
+{
+	char path[PATH_MAX];
+	struct NanoStatsEntry *entry;
+	uint64_t max;
+	uint64_t us = ns / 1000;
+	int bucket = 0;
+
+	nano_stats_resolve(name, path);
+	if ((entry = nano_stats_entry(path)) == NULL)
+	{
+		return;
+	}
+
+	while (us > 1 && bucket < NANO_STATS_BUCKETS - 1)
+	{
+		us >>= 1;
+		bucket++;
+	}
+
+	atomic_fetch_add(&entry->calls, 1);
+	atomic_fetch_add(&entry->failures, exit_status != 0);
+	atomic_fetch_add(&entry->total_ns, ns);
+	atomic_fetch_add(&entry->buckets[bucket], 1);
+	max = atomic_load(&entry->max_ns);
+	while (ns > max && !atomic_compare_exchange_weak(&entry->max_ns, &max, ns))
+		;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_percentile
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function estimates the percentile @param p (0 to 100) of the latencies of @param entry as the upper
+ * 		bound of the bucket where it is (at most the max).
+ * 
+ * @return Function returns the percentile in milliseconds
+ *******************************************************************************************************************/
+static double nano_stats_percentile(struct NanoStatsEntry *entry, double p)
+{
+	uint64_t calls = atomic_load(&entry->calls);
+	uint64_t seen = 0;
+
+	for (int b = 0; b < NANO_STATS_BUCKETS; b++)
+	{
+		seen += atomic_load(&entry->buckets[b]);
+		if (seen > 0 && (double)seen >= p / 100.0 * (double)calls)
+		{
+			uint64_t max = atomic_load(&entry->max_ns) / 1000;
+
+			return (double)((2ULL << b) < max ? (2ULL << b) : max) / 1000.0;
+		}
+	}
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_compare
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function compares the entries @param a and @param b by total time, for qsort (longest first).
+ * 
+ * @return Function returns < 0 if @param a has more total time, > 0 if @param b has and 0 if they are the same
+ *******************************************************************************************************************/
+static int nano_stats_compare(const void *a, const void *b)
+{
+	uint64_t total_a = atomic_load(&entries[*(const size_t *)a].total_ns);
+	uint64_t total_b = atomic_load(&entries[*(const size_t *)b].total_ns);
+
+	return total_a < total_b ? 1 : total_a > total_b ? -1 : 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_print
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes to @param fileptr the @param top executables (all of them with 0) with more total time:
+ * 		calls, failures, total, mean and max time and the 50th and 99th percentiles.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_stats_print(FILE *fileptr, unsigned int top)
+{
+	static size_t order[NANO_STATS_ENTRIES];
+	size_t count = 0;
+
+	for (size_t i = 0; i < NANO_STATS_ENTRIES; i++)
+	{
+		if (atomic_load(&entries[i].key) != 0 && entries[i].path[0] != 0 && atomic_load(&entries[i].calls) > 0)
+		{
+			order[count++] = i;
+		}
+	}
+	qsort(order, count, sizeof(size_t), nano_stats_compare);
+	if (top > 0 && top < count)
+	{
+		count = top;
+	}
+
+	fprintf(fileptr, "%-32s %8s %8s %10s %10s %10s %10s %10s\n", "executable", "calls", "failed", "total s", 
+			"mean ms", "max ms", "p50 ms", "p99 ms");
+	for (size_t i = 0; i < count; i++)
+	{
+		struct NanoStatsEntry *entry = &entries[order[i]];
+		uint64_t calls = atomic_load(&entry->calls);
+		uint64_t total = atomic_load(&entry->total_ns);
+
+		fprintf(fileptr, "%-32s %8llu %8llu %10.3f %10.3f %10.3f %10.3f %10.3f\n", entry->path,
+				(unsigned long long)calls, (unsigned long long)atomic_load(&entry->failures), (double)total / 1e9,
+				(double)total / 1e6 / (double)calls, (double)atomic_load(&entry->max_ns) / 1e6,
+				nano_stats_percentile(entry, 50), nano_stats_percentile(entry, 99));
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_stats_builtin
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function executes the builtin "stats [--top N]" with the arguments @param args, printing the table.
+ * 
+ * @return Function returns the exit status of the builtin: 0 if OK and 1 for wrong arguments
+ *******************************************************************************************************************/
+int nano_stats_builtin(char **args)
+{
+	long top = 0;
+
+	if (args[1] != NULL)
+	{
+		char *end = NULL;
+
+		if (strcmp(args[1], "--top") == 0 && args[2] != NULL && args[3] == NULL)
+		{
+			top = strtol(args[2], &end, 10);
+		}
+		if (end == NULL || *end != 0 || top <= 0)
+		{
+			printf("[ERROR] Usage: stats [--top N]\n");
+			return 1;
+		}
+	}
+	nano_stats_print(stdout, (unsigned int)top);
+	return 0;
+}
@@ -0,0 +1,18 @@
+/**
+* @file stats.h
+* @brief Statistics of the commands per executable (stats builtin and SIGUSR2)
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+void nano_stats_init(void);
+void nano_stats_resolve(const char *name, char *path);
+void nano_stats_record(const char *name, int exit_status, uint64_t ns);
+void nano_stats_print(FILE *fileptr, unsigned int top);
+int nano_stats_builtin(char **args);
+
+#endif /* STATS_H */
@@ -0,0 +1,256 @@
+/**
+* @file trace.c
+* @brief Chrome trace-event output of the nanoShell phases (--trace)
+*
+* Spans are stored as fixed size records in an in-memory ring and only formatted as JSON when nanoShell is idle
+* (between commands) or when the ring is full, so tracing doesn't add I/O between fork, exec and wait.
+* The output is the JSON array format of the Trace Event Format, that can be opened in Perfetto or chrome://tracing.
+* The workers of --jobs and xargs -P keep their own ring (nano_trace_child) and append it to the file when they
+* exit; the file is in append mode and every event after the first metadata one starts with a comma, so the
+* writes of the workers and of nanoShell can come in any order.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "trace.h"
+#include "nanoShell.h"
+
+#define NANO_TRACE_EVENTS 8192 // Size of the ring (power of 2)
+#define NANO_TRACE_CMDSIZE 24  // Size for the command name saved with each span
+#define NANO_TRACE_BUFSIZE 65536
+#define NANO_TRACE_EVENTSIZE 512 // Longest event written (the command is at most NANO_TRACE_CMDSIZE)
+
+struct NanoTraceEvent {
+	uint64_t start;
+	uint64_t end;
+	int tid;
+	int phase;
+	char cmd[NANO_TRACE_CMDSIZE];
+};
+
+static const char *phase_names[] = {"read", "validate", "split", "redirect", "fork", "exec", "wait", "throttle"};
+
+int nano_trace_enabled = 0;
+
+static struct NanoTraceEvent *ring;
+static size_t ring_head; // next position to write
+static size_t ring_tail; // next position to flush
+static FILE *trace_file;
+static char *trace_buffer;
+static size_t trace_pending; // Bytes in trace_buffer
+static uint64_t trace_origin;
+static pid_t trace_pid;  // nanoShell, that opened the trace
+static pid_t trace_self; // Process that owns the ring: nanoShell or a worker
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_open
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function creates the trace file @param path and the ring for the events, and enables tracing.
+ * 		The trace is closed by nano_trace_close, registered with atexit.
+ * 
+ * @return Function returns 0 if OK and -1 if the file couldn't be created
+ *******************************************************************************************************************/
+int nano_trace_open(const char *path)
+{
+	trace_file = fopen(path, "w");
+	if (trace_file == NULL)
+	{
+		return -1;
+	}
+
+	ring = MALLOC(NANO_TRACE_EVENTS * sizeof(struct NanoTraceEvent));
+	trace_buffer = MALLOC(NANO_TRACE_BUFSIZE);
+	if (ring == NULL || trace_buffer == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "[ERROR] Memory Allocation Failed\n");
+	}
+	memset(ring, 0, NANO_TRACE_EVENTS * sizeof(struct NanoTraceEvent));
+	setvbuf(trace_file, trace_buffer, _IOFBF, NANO_TRACE_BUFSIZE);
+
+	trace_origin = nano_time_ns();
+	trace_pid = getpid();
+	trace_self = trace_pid;
+	nano_trace_enabled = 1;
+
+	fcntl(fileno(trace_file), F_SETFL, fcntl(fileno(trace_file), F_GETFL) | O_APPEND);
+	fprintf(trace_file, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"nanoShell\"}}",
+			(int)trace_pid);
+	fflush(trace_file);
+	atexit(nano_trace_close);
+
+	return 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_now
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the clock for the start of a span, only when tracing is enabled.
+ * 
+ * @return Function returns the monotonic time in nanoseconds or 0 if tracing is disabled
+ *******************************************************************************************************************/
+uint64_t nano_trace_now(void)
+{
+	return nano_trace_enabled ? nano_time_ns() : 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_flush
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function writes every event of the ring to the trace file as a complete ("X") event, with the
+ * 		timestamps in microseconds since nano_trace_open.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_trace_flush(void)
+{
+	for (; ring_tail != ring_head; ring_tail++)
+	{
+		struct NanoTraceEvent *ev = &ring[ring_tail & (NANO_TRACE_EVENTS - 1)];
+		int written;
+
+		/* The workers append to the same file: the buffer is written before an event could be cut */
+		if (trace_pending + NANO_TRACE_EVENTSIZE > NANO_TRACE_BUFSIZE)
+		{
+			fflush(trace_file);
+			trace_pending = 0;
+		}
+		written = fprintf(trace_file, ",\n{\"name\":\"%s\",\"cat\":\"nanoShell\",\"ph\":\"X\",\"ts\":%.3f,"
+									  "\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"cmd\":\"%s\"}}",
+						  phase_names[ev->phase], (double)(ev->start - trace_origin) / 1000.0,
+						  (double)(ev->end - ev->start) / 1000.0, (int)trace_pid, ev->tid, ev->cmd);
+		trace_pending += written > 0 ? (size_t)written : 0;
+	}
+	/* Nothing can stay in the buffer, or the children would write it again when they exit */
+	fflush(trace_file);
+	trace_pending = 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_event
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function saves the span @param phase between @param start and @param end in the ring. @param tid is
+ * 		the PID of the child the span belongs to, or 0 for nanoShell itself (or the worker). Only the first characters of 
+ * 		@param cmd are kept, and characters that would need escaping in JSON are replaced.
+ * 		If the ring is full it is flushed right away.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_trace_event(int phase, uint64_t start, uint64_t end, int tid, const char *cmd)
+{
+	struct NanoTraceEvent *ev;
+
+	if (!nano_trace_enabled)
+	{
+		return;
+	}
+
+	if (ring_head - ring_tail == NANO_TRACE_EVENTS)
+	{
+		nano_trace_flush();
+	}
+
+	ev = &ring[ring_head & (NANO_TRACE_EVENTS - 1)];
+	ev->start = start;
+	ev->end = end;
+	ev->tid = tid != 0 ? tid : (int)trace_self;
+	ev->phase = phase;
+
+	size_t i = 0;
+	for (; cmd != NULL && cmd[i] != 0 && i < NANO_TRACE_CMDSIZE - 1; i++)
+	{
+		ev->cmd[i] = (cmd[i] == '"' || cmd[i] == '\\' || (unsigned char)cmd[i] < 32) ? '_' : cmd[i];
+	}
+	ev->cmd[i] = 0;
+
+	ring_head++;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_span
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function saves the span @param phase that started at @param start and ends now. See nano_trace_event.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_trace_span(int phase, uint64_t start, int tid, const char *cmd)
+{
+	if (nano_trace_enabled)
+	{
+		nano_trace_event(phase, start, nano_time_ns(), tid, cmd);
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_idle
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function is called when nanoShell has no command running. The ring is flushed when it is half full.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_trace_idle(void)
+{
+	if (nano_trace_enabled && ring_head - ring_tail >= NANO_TRACE_EVENTS / 2)
+	{
+		nano_trace_flush();
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_child
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function is called by a forked worker (--jobs, xargs -P): the events inherited from nanoShell are left
+ * 		to it, and the worker owns its ring until nano_trace_close appends it to the file.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_trace_child(void)
+{
+	if (nano_trace_enabled)
+	{
+		ring_tail = ring_head;
+		trace_self = getpid();
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_trace_close
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function flushes the remaining events and terminates the JSON array. In a worker the events are only 
+ * 		appended; it does nothing in the other children, that inherit the atexit registration.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_trace_close(void)
+{
+	if (!nano_trace_enabled || getpid() != trace_self)
+	{
+		return;
+	}
+
+	nano_trace_flush();
+	if (trace_self == trace_pid)
+	{
+		fprintf(trace_file, "\n]\n");
+	}
+	fclose(trace_file);
+
+	nano_trace_enabled = 0;
+	FREE(ring);
+	FREE(trace_buffer);
+}
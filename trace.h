@@ -0,0 +1,31 @@
+/**
+* @file trace.h
+* @brief Chrome trace-event output of the nanoShell phases (--trace)
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* Traced phases of a command */
+#define NANO_TRACE_READ 0
+#define NANO_TRACE_VALIDATE 1
+#define NANO_TRACE_SPLIT 2
+#define NANO_TRACE_REDIRECT 3
+#define NANO_TRACE_FORK 4
+#define NANO_TRACE_EXEC 5
+#define NANO_TRACE_WAIT 6
+#define NANO_TRACE_THROTTLE 7
+
+extern int nano_trace_enabled;
+
+int nano_trace_open(const char *path);
+uint64_t nano_trace_now(void);
+void nano_trace_event(int phase, uint64_t start, uint64_t end, int tid, const char *cmd);
+void nano_trace_span(int phase, uint64_t start, int tid, const char *cmd);
+void nano_trace_idle(void);
+void nano_trace_child(void);
+void nano_trace_close(void);
+
+#endif /* TRACE_H */
@@ -0,0 +1,480 @@
+/**
+* @file watch.c
+* @brief Incremental re-execution of the lines of a -f script changed since the last run (--watch)
+*
+* After the first run nanoShell stays alive with an inotify watch on the directory of the script (editors often
+* save with a new file renamed over the old one) and runs it again each time it is written. Each command line is
+* hashed with its annotations (#@id, #@inputs, #@priority) and here-documents: the lines with the hash of a line
+* that exited with status 0 in the last run are skipped, as --resume does with --journal, and the other ones are
+* executed. So are the lines declared "#@id NAME after A,B" after one that is executed, directly or not.
+*
+* The hashes are matched as a multiset, so a line repeated in the script is executed again if it is added once
+* more. Lines are moved freely: only their content matters, not their number.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "watch.h"
+#include "dag.h"
+#include "input.h"
+#include "nanoShell.h"
+
+#define NANO_WATCH_DEBOUNCE_MS 100 // Time without events before a run, as an editor may write more than once
+
+int nano_watch_enabled = 0;
+
+/* A command line of the script */
+struct NanoWatchUnit {
+	unsigned int number; // Line of the script
+	uint64_t hash;		 // Of the line, its annotations and here-documents
+	char *id;			 // Name given with #@id, NULL if not annotated
+	char *after;		 // Names of the predecessors
+	int execute;		 // Changed, or after a changed one
+	int status;			 // Exit status, 0 if skipped and -1 if not (yet) executed
+};
+
+/* A command line of the last run: its hash and exit status */
+struct NanoWatchPrevious {
+	uint64_t hash;
+	int status;
+	int matched;
+};
+
+static struct NanoWatchUnit *units;
+static size_t n_units;
+static size_t capacity;
+static struct NanoWatchPrevious *previous;
+static size_t n_previous;
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_load
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function reads the script @param path to memory, setting @param size.
+ * 
+ * @return Function returns the content of the script (to be freed) or NULL if it can't be read
+ *******************************************************************************************************************/
+static char *nano_watch_load(const char *path, size_t *size)
+{
+	struct stat info;
+	char *buffer;
+	ssize_t n = 0;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd == -1)
+	{
+		return NULL;
+	}
+	if (fstat(fd, &info) == -1 || (buffer = MALLOC((size_t)info.st_size + 1)) == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+	for (*size = 0; *size < (size_t)info.st_size; *size += (size_t)n)
+	{
+		n = read(fd, buffer + *size, (size_t)info.st_size - *size);
+		if (n == -1 && errno == EINTR)
+		{
+			n = 0;
+		}
+		else if (n <= 0)
+		{
+			break;
+		}
+	}
+	close(fd);
+	if (n == -1)
+	{
+		FREE(buffer);
+		return NULL;
+	}
+	buffer[*size] = 0;
+	return buffer;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_add
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function appends the command line @param number with @param hash to the units, with the pending #@id 
+ * 		annotation @param id and @param after (both may be NULL), which are owned by the unit from now on.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_watch_add(unsigned int number, uint64_t hash, char *id, char *after)
+{
+	struct NanoWatchUnit *unit;
+
+	if (n_units == capacity)
+	{
+		capacity = capacity ? capacity * 2 : 16;
+		unit = REALLOC(units, capacity * sizeof(struct NanoWatchUnit));
+		if (unit == NULL)
+		{
+			ERROR(NANO_ERROR_MALLOC, "Error allocating memory for --watch\n");
+		}
+		units = unit;
+	}
+
+	unit = &units[n_units++];
+	unit->number = number;
+	unit->hash = hash;
+	unit->id = id;
+	unit->after = after;
+	unit->execute = 1;
+	unit->status = -1;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_parse
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function splits the script @param buffer of @param size bytes in units, one for each command line with 
+ * 		the same rule of -f, hashed with the annotations before it and its here-documents.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_watch_parse(char *buffer, size_t size)
+{
+	FILE *fileptr = fmemopen(buffer, size, "r");
+	char *lineptr = NULL;
+	size_t n = 0;
+	ssize_t length;
+	unsigned int number = 0;
+	uint64_t pending = NANO_FNV_OFFSET;
+	char *id = NULL;
+	char *after = NULL;
+
+	if (fileptr == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error reading the script for --watch\n");
+	}
+
+	while ((length = getline(&lineptr, &n, fileptr)) != -1)
+	{
+		long begin = ftell(fileptr) - length;
+
+		number++;
+		lineptr[strcspn(lineptr, "\n")] = 0;
+
+		if (strncmp(lineptr, "#@", 2) == 0)
+		{
+			pending = nano_fnv1a(pending, lineptr, strlen(lineptr) + 1);
+			if (strncmp(lineptr, NANO_DAG_ANNOTATION, strlen(NANO_DAG_ANNOTATION)) == 0)
+			{
+				char *save;
+				char *name = strtok_r(lineptr + strlen(NANO_DAG_ANNOTATION), NANO_DAG_DELIMITERS, &save);
+				char *keyword = strtok_r(NULL, NANO_DAG_DELIMITERS, &save);
+
+				FREE(id);
+				FREE(after);
+				id = name != NULL ? STRDUP(name) : NULL;
+				after = keyword != NULL && strcmp(keyword, "after") == 0 && save != NULL ? STRDUP(save) : NULL;
+			}
+		}
+		//Verifies for #, [LINE FEED], [SPACE], [HORIZONTAL TAB] to ignore line, as -f
+		else if (lineptr[0] != 35 && lineptr[0] != 0 && lineptr[0] != 32 && lineptr[0] != 9)
+		{
+			/* The here-documents are part of the line */
+			int heredoc_lines = nano_heredoc_collect(lineptr, fileptr, NULL);
+
+			nano_heredoc_clear();
+			nano_watch_add(number, nano_fnv1a(pending, buffer + begin, (size_t)(ftell(fileptr) - begin)), id, after);
+			number += heredoc_lines > 0 ? (unsigned int)heredoc_lines : 0;
+			pending = NANO_FNV_OFFSET;
+			id = NULL;
+			after = NULL;
+		}
+	}
+	FREE(id);
+	FREE(after);
+	free(lineptr);
+	fclose(fileptr);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_after_executed
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies if one of the predecessors declared by @param unit is executed.
+ * 
+ * @return Function returns 1 if it is and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_watch_after_executed(const struct NanoWatchUnit *unit)
+{
+	char *save;
+	char *names;
+	int res = 0;
+
+	if (unit->after == NULL || (names = STRDUP(unit->after)) == NULL)
+	{
+		return 0;
+	}
+	for (char *name = strtok_r(names, NANO_DAG_DELIMITERS, &save); name != NULL && !res;
+		 name = strtok_r(NULL, NANO_DAG_DELIMITERS, &save))
+	{
+		for (size_t i = 0; i < n_units && !res; i++)
+		{
+			res = units[i].execute && units[i].id != NULL && strcmp(units[i].id, name) == 0;
+		}
+	}
+	FREE(names);
+	return res;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_plan
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function decides which units are executed: the ones without a match among the lines that exited with 
+ * 		status 0 in the last run, and the ones after them.
+ * 
+ * @return Function returns the number of units executed
+ *******************************************************************************************************************/
+static size_t nano_watch_plan(void)
+{
+	size_t executed = 0;
+	int changed = 1;
+
+	for (size_t i = 0; i < n_units; i++)
+	{
+		for (size_t j = 0; j < n_previous && units[i].execute; j++)
+		{
+			if (!previous[j].matched && previous[j].status == 0 && previous[j].hash == units[i].hash)
+			{
+				previous[j].matched = 1;
+				units[i].execute = 0;
+				units[i].status = 0;
+			}
+		}
+	}
+
+	/* Until a fixed point, as a line may be declared after a later one */
+	while (changed)
+	{
+		changed = 0;
+		for (size_t i = 0; i < n_units; i++)
+		{
+			if (!units[i].execute && nano_watch_after_executed(&units[i]))
+			{
+				units[i].execute = 1;
+				units[i].status = -1;
+				changed = 1;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < n_units; i++)
+	{
+		executed += units[i].execute;
+	}
+	return executed;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_commit
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function keeps the hashes and exit status of the units of the run that ended, for the next one.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_watch_commit(void)
+{
+	FREE(previous);
+	previous = MALLOC((n_units + 1) * sizeof(struct NanoWatchPrevious));
+	if (previous == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating memory for --watch\n");
+	}
+	for (size_t i = 0; i < n_units; i++)
+	{
+		previous[i].hash = units[i].hash;
+		previous[i].status = units[i].status;
+		previous[i].matched = 0;
+		FREE(units[i].id);
+		FREE(units[i].after);
+	}
+	n_previous = n_units;
+	n_units = 0;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_find
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function looks for the unit of the command at @param line of the script (the units are sorted by line).
+ * 
+ * @return Function returns the unit or NULL if there isn't one
+ *******************************************************************************************************************/
+static struct NanoWatchUnit *nano_watch_find(unsigned int line)
+{
+	size_t low = 0;
+	size_t high = n_units;
+
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+
+		if (units[middle].number < line)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low < n_units && units[low].number == line ? &units[low] : NULL;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_done
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies if the command at @param line of the script is skipped in this run of --watch.
+ * 
+ * @return Function returns 1 if it is skipped and 0 if it is executed (always without --watch)
+ *******************************************************************************************************************/
+int nano_watch_done(unsigned int line)
+{
+	struct NanoWatchUnit *unit = nano_watch_enabled ? nano_watch_find(line) : NULL;
+
+	return unit != NULL && !unit->execute;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_record
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function saves the @param exit_status of the command at @param line of the script, executed in this 
+ * 		run of --watch.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+void nano_watch_record(unsigned int line, int exit_status)
+{
+	struct NanoWatchUnit *unit = nano_watch_enabled ? nano_watch_find(line) : NULL;
+
+	if (unit != NULL)
+	{
+		unit->status = exit_status;
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_wait
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function waits on the inotify @param fd until the file @param name of the watched directory is written,
+ * 		and then until there are no more events for NANO_WATCH_DEBOUNCE_MS.
+ * 
+ * @return Function returns 0 if OK and -1 if inotify fails
+ *******************************************************************************************************************/
+static int nano_watch_wait(int fd, const char *name)
+{
+	_Alignas(struct inotify_event) char events[4096];
+	struct pollfd pfd = {.fd = fd, .events = POLLIN};
+	int written = 0;
+
+	while (1)
+	{
+		ssize_t n;
+
+		if (written && poll(&pfd, 1, NANO_WATCH_DEBOUNCE_MS) == 0)
+		{
+			return 0;
+		}
+		n = read(fd, events, sizeof(events));
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			return -1;
+		}
+		for (char *p = events; p < events + n; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len)
+		{
+			struct inotify_event *event = (struct inotify_event *)p;
+
+			written |= event->len > 0 && strcmp(event->name, name) == 0;
+		}
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_watch_run
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function runs the script @param path with @param exec_file (on @param jobs workers, 0 without --jobs)
+ * 		and again each time it is written, executing only the lines changed and the ones after them. 
+ * 
+ * @return Function returns only if inotify fails: -1
+ *******************************************************************************************************************/
+int nano_watch_run(const char *path, unsigned int jobs, int (*exec_file)(FILE *fileptr, unsigned int jobs))
+{
+	char *copy_dir = STRDUP(path);
+	char *copy_name = STRDUP(path);
+	const char *name;
+	int fd = inotify_init1(IN_CLOEXEC);
+
+	if (copy_dir == NULL || copy_name == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating memory for --watch\n");
+	}
+	name = basename(copy_name);
+	if (fd == -1 || inotify_add_watch(fd, dirname(copy_dir), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+	{
+		FREE(copy_dir);
+		FREE(copy_name);
+		return -1;
+	}
+	nano_watch_enabled = 1;
+
+	do
+	{
+		size_t size = 0;
+		char *buffer = nano_watch_load(path, &size);
+		FILE *fileptr;
+
+		if (buffer == NULL)
+		{
+			WARNING("Error reading %s", path);
+			continue;
+		}
+		nano_watch_parse(buffer, size);
+		printf("[INFO] Executing %zu of the %zu command lines of %s (changed or after a changed one)\n", 
+			   nano_watch_plan(), n_units, path);
+
+		/* fmemopen of 0 bytes isn't portable, and there is nothing to do */
+		if (size > 0 && (fileptr = fmemopen(buffer, size, "r")) != NULL)
+		{
+			exec_file(fileptr, jobs);
+			fclose(fileptr);
+		}
+		nano_watch_commit();
+		FREE(buffer);
+
+		printf("[INFO] Watching %s for changes (Ctrl+C to stop)\n", path);
+		fflush(stdout);
+	} while (nano_watch_wait(fd, name) == 0);
+
+	close(fd);
+	FREE(copy_dir);
+	FREE(copy_name);
+	return -1;
+}
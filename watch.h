@@ -0,0 +1,17 @@
+/**
+* @file watch.h
+* @brief Incremental re-execution of the lines of a -f script changed since the last run (--watch)
+*/
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdio.h>
+
+extern int nano_watch_enabled;
+
+int nano_watch_run(const char *path, unsigned int jobs, int (*exec_file)(FILE *fileptr, unsigned int jobs));
+int nano_watch_done(unsigned int line);
+void nano_watch_record(unsigned int line, int exit_status);
+
+#endif /* WATCH_H */
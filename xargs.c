@@ -0,0 +1,368 @@
+/**
+* @file xargs.c
+* @brief Builtin xargs: the items of its input packed into argument lists as large as exec allows
+*
+* "xargs [-P N] [-n MAX] [-a FILE] COMMAND [ARGS] [REDIRECT]" reads one item per line (from FILE, the input 
+* redirect or stdin) and executes COMMAND ARGS with as many items as fit: the strings and pointers of the 
+* arguments and of the environment of the command must fit in sysconf(_SC_ARG_MAX), less NANO_XARGS_HEADROOM as
+* POSIX asks. The items are read as the batches are launched, so the list can be of any size.
+*
+* Each batch is executed by nano_exec_simple, so it is counted, rate limited, placed and prioritized as any
+* other command. A redirect at the end applies to each batch (>> or 2>> to keep the output of all of them). With
+* -P N the batches run on up to N forked workers at once, which count in the shared counters, take the tokens of
+* --rate from the shared bucket and append to the --record and --trace files of nanoShell.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "debug.h"
+#include "memory.h"
+#include "record.h"
+#include "trace.h"
+#include "xargs.h"
+#include "nanoShell.h"
+
+#define NANO_XARGS_HEADROOM 2048 // Bytes of ARG_MAX left free (POSIX)
+#define NANO_XARGS_MAX_ITEM (32 * 4096) // Longest argument accepted by Linux (MAX_ARG_STRLEN)
+#define NANO_XARGS_MAX_JOBS 4096 // Most workers of -P
+
+extern char **environ;
+
+/* A batch being filled: the fixed arguments, the items and the redirect at the end */
+struct NanoXargsBatch {
+	char **argv;
+	size_t argc;
+	size_t n_items;
+	size_t cost;  // Bytes of ARG_MAX used by the items
+	char *arena; // Copies of the items
+	size_t used;
+	pid_t *workers; // Of -P, 0 if the slot is free
+};
+
+
+/*******************************************************************************************************************
+ * Function nano_xargs_cost
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function computes what the string @param str takes of ARG_MAX as an argument or environment variable.
+ * 
+ * @return Function returns the number of bytes
+ *******************************************************************************************************************/
+static size_t nano_xargs_cost(const char *str)
+{
+	return strlen(str) + 1 + sizeof(char *);
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_xargs_redirect
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function verifies if @param str is a redirect operator of nanoShell, which can't be an item.
+ * 
+ * @return Function returns 1 if it is and 0 otherwise
+ *******************************************************************************************************************/
+static int nano_xargs_redirect(const char *str)
+{
+	static const char *operators[] = {">", ">>", "2>", "2>>", ">z", ">>z", NULL};
+
+	for (int i = 0; operators[i] != NULL; i++)
+	{
+		if (strcmp(str, operators[i]) == 0)
+		{
+			return 1;
+		}
+	}
+	/* Input redirects can be joined to their word (<FILE) */
+	return str[0] == '<';
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_xargs_reap
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function waits for one of the @param jobs workers of @param batch to exit, decrementing @param running
+ * 		and counting its failure in @param failed. Other children of nanoShell (the server of --metrics-socket)
+ * 		that exit meanwhile aren't counted.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_xargs_reap(struct NanoXargsBatch *batch, unsigned int jobs, unsigned int *running, 
+							unsigned int *failed)
+{
+	for (;;)
+	{
+		int wstatus;
+		pid_t pid = waitpid(-1, &wstatus, 0);
+
+		if (pid == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			ERROR(NANO_ERROR_FORK, "Error waiting for the xargs workers\n");
+		}
+		for (unsigned int i = 0; i < jobs; i++)
+		{
+			if (batch->workers[i] == pid)
+			{
+				batch->workers[i] = 0;
+				(*running)--;
+				*failed += !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0;
+				return;
+			}
+		}
+	}
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_xargs_run
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function executes the @param batch with @param exec, ending its arguments with the redirect 
+ * 		@param tail of @param n_tail tokens. With @param jobs > 1 it runs in a forked worker, after waiting for
+ * 		one if @param running already has @param jobs. The failures are counted in @param failed.
+ * 
+ * @return Function returns void
+ *******************************************************************************************************************/
+static void nano_xargs_run(struct NanoXargsBatch *batch, char **tail, size_t n_tail, unsigned int jobs,
+						   unsigned int *running, unsigned int *failed, int (*exec)(char **args, int tail))
+{
+	memcpy(&batch->argv[batch->argc + batch->n_items], tail, (n_tail + 1) * sizeof(char *));
+
+	if (jobs <= 1)
+	{
+		*failed += exec(batch->argv, 0) != 0;
+		return;
+	}
+
+	if (*running >= jobs)
+	{
+		nano_xargs_reap(batch, jobs, running, failed);
+	}
+
+	/* The worker would write again what is still in the buffer */
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid = fork();
+	if (pid == -1)
+	{
+		ERROR(NANO_ERROR_FORK, "Error executing fork().\n");
+	}
+	else if (pid == 0)
+	{
+		/* exit() would move the shared offset of the items (and of the -f script) back to what its buffer has 
+		 * read, so the buffers of the recording and the trace are written here and not by the atexit handlers */
+		int status;
+
+		nano_record_child();
+		nano_trace_child();
+		status = exec(batch->argv, 0);
+		nano_record_close();
+		nano_trace_close();
+		fflush(stdout);
+		fflush(stderr);
+		_exit(status);
+	}
+	for (unsigned int i = 0; i < jobs; i++)
+	{
+		if (batch->workers[i] == 0)
+		{
+			batch->workers[i] = pid;
+			break;
+		}
+	}
+	(*running)++;
+}
+
+
+/*******************************************************************************************************************
+ * Function nano_xargs_builtin
+ * ---------------------------------------------------------------------------------------------------------------
+ *  @brief Function executes the builtin "xargs [-P N] [-n MAX] [-a FILE] COMMAND [ARGS] [REDIRECT]" with the
+ * 		arguments @param args, after the @param n_assigns assignments @param assigns, reading the items from
+ * 		@param input_fd (closed by the builtin), or stdin if it is -1. Each batch is executed with @param exec.
+ * 
+ * @return Function returns the exit status of the builtin: 0 if all the batches exited with 0, 
+ * 		NANO_XARGS_FAILED if any failed and 1 for wrong arguments
+ *******************************************************************************************************************/
+int nano_xargs_builtin(char **assigns, size_t n_assigns, char **args, int input_fd, 
+					   int (*exec)(char **args, int tail))
+{
+	struct NanoXargsBatch batch = {0};
+	unsigned long jobs = 1;
+	unsigned long max_items = 0;
+	unsigned int running = 0;
+	unsigned int failed = 0;
+	unsigned long batches = 0;
+	unsigned long items = 0;
+	const char *file = NULL;
+	size_t command = 1;
+	char **fixed;
+	size_t n_fixed = 0;
+	char **tail;
+	size_t n_tail;
+	size_t limit;
+	long arg_max = sysconf(_SC_ARG_MAX);
+	FILE *fileptr = stdin;
+	char *lineptr = NULL;
+	size_t n = 0;
+	ssize_t length;
+	int res = 0;
+
+	/* Options before the command */
+	while (args[command] != NULL && args[command + 1] != NULL && args[command][0] == '-')
+	{
+		char *end;
+		unsigned long value = strtoul(args[command + 1], &end, 10);
+
+		if (strcmp(args[command], "-a") == 0)
+		{
+			file = args[command + 1];
+		}
+		else if (*end != 0 || value == 0)
+		{
+			break;
+		}
+		else if (strcmp(args[command], "-P") == 0)
+		{
+			jobs = value < NANO_XARGS_MAX_JOBS ? value : NANO_XARGS_MAX_JOBS;
+		}
+		else if (strcmp(args[command], "-n") == 0)
+		{
+			max_items = value;
+		}
+		else
+		{
+			break;
+		}
+		command += 2;
+	}
+	if (args[command] == NULL || args[command][0] == '-' || nano_xargs_redirect(args[command]))
+	{
+		printf("[ERROR] Usage: xargs [-P N] [-n MAX] [-a FILE] COMMAND [ARGS] [REDIRECT]\n");
+		if (input_fd != -1)
+		{
+			close(input_fd);
+		}
+		return 1;
+	}
+
+	/* The command and its arguments come before the items, the redirect after them */
+	fixed = &args[command];
+	while (fixed[n_fixed] != NULL && !nano_xargs_redirect(fixed[n_fixed]))
+	{
+		n_fixed++;
+	}
+	tail = &fixed[n_fixed];
+	for (n_tail = 0; tail[n_tail] != NULL; n_tail++)
+		;
+	batch.argc = n_assigns + n_fixed;
+
+	/* What is left of ARG_MAX for the items, after the environment and the fixed arguments */
+	limit = arg_max > 0 ? (size_t)arg_max : NANO_XARGS_MAX_ITEM;
+	for (char **env = environ; *env != NULL; env++)
+	{
+		limit -= nano_xargs_cost(*env) < limit ? nano_xargs_cost(*env) : limit;
+	}
+	for (size_t i = 0; i < batch.argc; i++)
+	{
+		const char *arg = i < n_assigns ? assigns[i] : fixed[i - n_assigns];
+
+		limit -= nano_xargs_cost(arg) < limit ? nano_xargs_cost(arg) : limit;
+	}
+	limit = limit > NANO_XARGS_HEADROOM + sizeof(char *) ? limit - NANO_XARGS_HEADROOM - sizeof(char *) : 0;
+
+	batch.argv = MALLOC((batch.argc + limit / sizeof(char *) + n_tail + 1) * sizeof(char *));
+	batch.arena = MALLOC(limit + 1);
+	batch.workers = MALLOC(jobs * sizeof(pid_t));
+	if (batch.argv == NULL || batch.arena == NULL || batch.workers == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error allocating memory for xargs\n");
+	}
+	memset(batch.workers, 0, jobs * sizeof(pid_t));
+	memcpy(batch.argv, assigns, n_assigns * sizeof(char *));
+	memcpy(&batch.argv[n_assigns], fixed, n_fixed * sizeof(char *));
+
+	if (file != NULL)
+	{
+		if (input_fd != -1)
+		{
+			close(input_fd);
+		}
+		input_fd = open(file, O_RDONLY | O_CLOEXEC);
+		if (input_fd == -1)
+		{
+			printf("[ERROR] Error opening %s: %s\n", file, strerror(errno));
+			res = 1;
+		}
+	}
+	if (input_fd != -1 && (fileptr = fdopen(input_fd, "r")) == NULL)
+	{
+		ERROR(NANO_ERROR_MALLOC, "Error reading the items of xargs\n");
+	}
+
+	while (res == 0 && (length = getline(&lineptr, &n, fileptr)) != -1)
+	{
+		lineptr[strcspn(lineptr, "\n")] = 0;
+		if (lineptr[0] == 0)
+		{
+			continue;
+		}
+		if (strlen(lineptr) >= NANO_XARGS_MAX_ITEM || nano_xargs_cost(lineptr) > limit || 
+			nano_xargs_redirect(lineptr))
+		{
+			printf("[ERROR] xargs: item '%.40s' is too long or a redirect\n", lineptr);
+			failed++;
+			continue;
+		}
+
+		/* The item doesn't fit: the batch is executed and a new one started */
+		if (batch.cost + nano_xargs_cost(lineptr) > limit || (max_items > 0 && batch.n_items == max_items))
+		{
+			nano_xargs_run(&batch, tail, n_tail, (unsigned int)jobs, &running, &failed, exec);
+			batches++;
+			batch.n_items = 0;
+			batch.cost = 0;
+			batch.used = 0;
+		}
+		batch.argv[batch.argc + batch.n_items++] = strcpy(batch.arena + batch.used, lineptr);
+		batch.used += strlen(lineptr) + 1;
+		batch.cost += nano_xargs_cost(lineptr);
+		items++;
+	}
+	if (batch.n_items > 0)
+	{
+		nano_xargs_run(&batch, tail, n_tail, (unsigned int)jobs, &running, &failed, exec);
+		batches++;
+	}
+
+	/* The last workers */
+	while (running > 0)
+	{
+		nano_xargs_reap(&batch, (unsigned int)jobs, &running, &failed);
+	}
+
+	DEBUG("xargs: %lu item(s) in %lu batch(es) of up to %zu bytes, %u failed", items, batches, limit, failed);
+	if (fileptr != stdin)
+	{
+		fclose(fileptr);
+	}
+	else
+	{
+		clearerr(stdin);
+	}
+	free(lineptr);
+	FREE(batch.argv);
+	FREE(batch.arena);
+	FREE(batch.workers);
+	return res != 0 ? res : failed > 0 ? NANO_XARGS_FAILED : 0;
+}
@@ -0,0 +1,16 @@
+/**
+* @file xargs.h
+* @brief Builtin xargs: the items of its input packed into argument lists as large as exec allows
+*/
+
+#ifndef XARGS_H
+#define XARGS_H
+
+#include <stddef.h>
+
+#define NANO_XARGS_FAILED 123 // Exit status if any batch failed, as the xargs of GNU and BSD
+
+int nano_xargs_builtin(char **assigns, size_t n_assigns, char **args, int input_fd, 
+					   int (*exec)(char **args, int tail));
+
+#endif /* XARGS_H */